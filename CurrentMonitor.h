@@ -0,0 +1,128 @@
+#ifndef CURRENT_MONITOR_H
+#define CURRENT_MONITOR_H
+
+#include <Arduino.h>
+
+// Summary of the samples currently in the window, all in mA x 100
+struct CurrentStats {
+    int32_t min;
+    int32_t max;
+    int32_t mean;
+    int32_t rms;
+    uint16_t samples;
+};
+
+// Keeps the last N pump current samples and decides when the pump has to be stopped. A trip
+// needs debounceSamples consecutive samples outside the limits, and nothing trips during the
+// inrush grace period after reset(), while the motor draws its start-up current.
+// Currents are fixed point mA x 100 throughout, the ESP8266 has no FPU.
+template <size_t N>
+class CurrentMonitor {
+public:
+    enum Trip : uint8_t { NONE, DRY_RUN, OVER_CURRENT };
+
+    CurrentMonitor(int32_t dryRunCentiMa, int32_t overCurrentCentiMa, uint32_t inrushGraceMs, uint8_t debounceSamples)
+        : dryRunCentiMa(dryRunCentiMa), overCurrentCentiMa(overCurrentCentiMa), inrushGraceMs(inrushGraceMs),
+          debounceSamples(debounceSamples) {
+        reset(0);
+    }
+
+    // Start a new run, called when the pump is switched on
+    void reset(uint32_t nowMs) {
+        head = 0;
+        count = 0;
+        startedMs = nowMs;
+        lowCount = 0;
+        highCount = 0;
+        firstOutOfRangeMs = 0;
+        tripLatencyMs = 0;
+        tripped = NONE;
+    }
+
+    // Add one sample, returns the trip reason the first time a limit is confirmed
+    Trip addSample(int32_t currentCentiMa, uint32_t nowMs) {
+        samples[head] = currentCentiMa;
+        head = (head + 1) % N;
+        if (count < N) count++;
+
+        if (tripped != NONE || nowMs - startedMs < inrushGraceMs) {
+            return NONE;
+        }
+
+        bool low = currentCentiMa < dryRunCentiMa;
+        bool high = currentCentiMa > overCurrentCentiMa;
+        if ((low || high) && lowCount == 0 && highCount == 0) {
+            firstOutOfRangeMs = nowMs;
+        }
+        lowCount = low ? lowCount + 1 : 0;
+        highCount = high ? highCount + 1 : 0;
+
+        if (highCount >= debounceSamples) {
+            tripped = OVER_CURRENT;
+        } else if (lowCount >= debounceSamples) {
+            tripped = DRY_RUN;
+        } else {
+            return NONE;
+        }
+        tripLatencyMs = nowMs - firstOutOfRangeMs;
+        return tripped;
+    }
+
+    CurrentStats stats() const {
+        CurrentStats result = {0, 0, 0, 0, (uint16_t)count};
+        if (count == 0) return result;
+
+        int64_t sum = 0;
+        uint64_t sumSquares = 0;
+        result.min = result.max = samples[(head + N - count) % N];
+        for (size_t i = 0; i < count; ++i) {
+            int32_t sample = samples[(head + N - count + i) % N];
+            if (sample < result.min) result.min = sample;
+            if (sample > result.max) result.max = sample;
+            sum += sample;
+            sumSquares += (uint64_t)((int64_t)sample * sample);
+        }
+        result.mean = sum / (int32_t)count;
+        result.rms = isqrt(sumSquares / count);
+        return result;
+    }
+
+    Trip getTrip() const { return tripped; }
+
+    // Time from the first out-of-limit sample to the confirmed trip
+    uint32_t getTripLatencyMs() const { return tripLatencyMs; }
+
+private:
+    // Bitwise integer square root, 32 iterations of shifts and adds
+    static uint32_t isqrt(uint64_t value) {
+        uint64_t root = 0;
+        uint64_t bit = 1ULL << 62;
+        while (bit > value) bit >>= 2;
+        while (bit) {
+            if (value >= root + bit) {
+                value -= root + bit;
+                root = (root >> 1) + bit;
+            } else {
+                root >>= 1;
+            }
+            bit >>= 2;
+        }
+        return root;
+    }
+
+    int32_t samples[N];
+    size_t head;
+    size_t count;
+    int32_t dryRunCentiMa;
+    int32_t overCurrentCentiMa;
+    uint32_t inrushGraceMs;
+    uint8_t debounceSamples;
+    uint32_t startedMs;
+    uint8_t lowCount;
+    uint8_t highCount;
+    uint32_t firstOutOfRangeMs;
+    uint32_t tripLatencyMs;
+    Trip tripped;
+};
+
+#endif // CURRENT_MONITOR_H
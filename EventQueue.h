@@ -0,0 +1,85 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Lock-free ring buffer for handing events from one producer context (the Ticker callbacks)
+// to one consumer (loop()). N must be a power of two. A full queue drops the new event and
+// counts it, so a stalled loop() can never block the producer.
+template <typename T, size_t N>
+class EventQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "EventQueue size must be a power of two");
+
+public:
+    EventQueue() : head(0), tail(0), highWater(0), dropped(0), droppedTotal(0), processed(0), maxLatencyUs(0), totalLatencyUs(0) {}
+
+    // Producer side
+    bool push(const T& event) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t depth = h - tail.load(std::memory_order_acquire);
+        if (depth >= N) {
+            dropped++;
+            droppedTotal++;
+            return false;
+        }
+        slots[h & (N - 1)].event = event;
+        slots[h & (N - 1)].queuedAt = micros();
+        head.store(h + 1, std::memory_order_release);
+        if (depth + 1 > highWater) highWater = depth + 1;
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T& event) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        event = slots[t & (N - 1)].event;
+        uint32_t latency = micros() - slots[t & (N - 1)].queuedAt;
+        tail.store(t + 1, std::memory_order_release);
+
+        processed++;
+        totalLatencyUs += latency;
+        if (latency > maxLatencyUs) maxLatencyUs = latency;
+        return true;
+    }
+
+    size_t depth() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    // Deepest the queue has been, events dropped because it was full, and the time events
+    // spent queued before loop() picked them up
+    uint32_t getHighWater() const { return highWater; }
+    uint32_t getDropped() const { return dropped; }
+    uint32_t getDroppedTotal() const { return droppedTotal; }  // Since boot, resetStats() keeps it
+    uint32_t getProcessed() const { return processed; }
+    uint32_t getMaxLatencyUs() const { return maxLatencyUs; }
+    uint32_t getAverageLatencyUs() const { return processed ? totalLatencyUs / processed : 0; }
+
+    void resetStats() {
+        highWater = depth();
+        dropped = 0;
+        processed = 0;
+        maxLatencyUs = 0;
+        totalLatencyUs = 0;
+    }
+
+private:
+    struct Slot {
+        T event;
+        uint32_t queuedAt;
+    };
+
+    Slot slots[N];
+    std::atomic<uint32_t> head;  // Written only by the producer
+    std::atomic<uint32_t> tail;  // Written only by the consumer
+    volatile uint32_t highWater;
+    volatile uint32_t dropped;
+    volatile uint32_t droppedTotal;
+    uint32_t processed;
+    uint32_t maxLatencyUs;
+    uint64_t totalLatencyUs;
+};
+
+#endif // EVENT_QUEUE_H
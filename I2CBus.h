@@ -0,0 +1,30 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+// Ownership of the Wire bus between loop() and the current sampler, the one Timer that does I2C
+// from Ticker context. loop() holds an I2CBusLock around every transfer; the sampler checks
+// I2CBus::busy() and skips its reading while loop() is in the middle of one. SYS context only
+// runs where loop() yields, so a plain flag is enough, no atomics.
+class I2CBus {
+public:
+    static bool busy() { return held; }
+
+private:
+    friend class I2CBusLock;
+    static inline volatile bool held = false;
+};
+
+// Holds the bus for its scope. Nested locks leave it held until the outermost one ends.
+class I2CBusLock {
+public:
+    I2CBusLock() : wasHeld(I2CBus::held) { I2CBus::held = true; }
+    ~I2CBusLock() { I2CBus::held = wasHeld; }
+
+    I2CBusLock(const I2CBusLock&) = delete;
+    I2CBusLock& operator=(const I2CBusLock&) = delete;
+
+private:
+    bool wasHeld;
+};
+
+#endif // I2C_BUS_H
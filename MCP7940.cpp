@@ -5,33 +5,36 @@ Arduino Library for the MCP7940M and MCP7940N Real-Time Clock devices\n\n
 See main library header file for details
 */
 #include "MCP7940.h"
-/*! Define the number of days in each month */
-const uint8_t   daysInMonth[] PROGMEM = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+/*! Days from 1600-03-01 to 2000-01-01, the epoch of the March-based day count */
+const uint32_t DAYS_1600_TO_2000{146037};
+/*! Days in a 400 year Gregorian era */
+const uint32_t DAYS_PER_ERA{146097};
+/*! Registers held in the shadow register cache */
+const uint8_t cachedRegister[MCP7940_CACHE_SIZE] PROGMEM = {
+    MCP7940_CONTROL, MCP7940_OSCTRIM, MCP7940_ALM0WKDAY, MCP7940_ALM1WKDAY, MCP7940_RTCWKDAY};
+/*! Bits of each cached register only ever changed by software. ALMxIF, OSCRUN, PWRFAIL, the
+ * running weekday and the read-only ALMPOL copy in ALM1WKDAY are changed by the device itself */
+const uint8_t cachedMask[MCP7940_CACHE_SIZE] PROGMEM = {0xFF, 0xFF, 0xF7, 0x77, 0x08};
 static uint16_t date2days(uint16_t y, uint8_t m, uint8_t d) {
   /*!
-   * @brief   returns the number of days from a given Y M D value
+   * @brief   returns the number of days from 2000-01-01 to a given Y M D value
+   * @details Loop-free days-from-civil conversion. Years are counted from 1 March so the leap day
+   *          is the last day of the year and the month lengths follow the 153/5 pattern, which
+   *          leaves only constant divisions. Valid from 2000-01-01 to 2179-06-06
    * @param[in] y Year
    * @param[in] m Month
    * @param[in] d Day
-   * @return    number of days from a given Y M D value
+   * @return    number of days since 2000-01-01
    */
   if (y >= 2000) {
     y -= 2000;
-  }  // of if-then year is greater than 2000
-  uint16_t days = d;
-  for (uint8_t i = 1; i < m; ++i)  // Add number of days for each month
-  {
-    days += pgm_read_byte(daysInMonth + i - 1);
-  }                         // of for-next loop for each month
-  if (m > 2 && y % 4 == 0)  // Deal with leap years
-  {
-    ++days;
-  }                                          // of if-then a leap year
-  if (((y % 100) == 0) && ((y % 400) != 0))  // if / by 100 but not by 400 then it is not a l.y.
-  {
-    --days;
-  }                                         // of if-then special leap year
-  return days + 365 * y + (y + 3) / 4 - 1;  // Return computed value
+  }                                               // of if-then year is greater than 2000
+  uint32_t year = y + 400 - (m <= 2);             // March-based year counted from 1600
+  uint32_t era  = year / 400;                     // 400 year era, 0 or 1
+  uint32_t yoe  = year - era * 400;               // year of era 0-399
+  uint32_t doy  = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;  // day of March-based year
+  uint32_t doe  = yoe * 365 + yoe / 4 - yoe / 100 + doy;           // day of era
+  return era * DAYS_PER_ERA + doe - DAYS_1600_TO_2000;             // Return computed value
 }  // of method date2days
 static long time2long(uint16_t days, uint8_t h, uint8_t m, uint8_t s) {
   /*!
@@ -63,26 +66,20 @@ DateTime::DateTime(uint32_t t) {
    constructor so there are multiple definitions. This implementation ignores time zones and DST
    changes. It also ignores leap seconds, see http://en.wikipedia.org/wiki/Leap_second
    @param[in] t seconds since the year 1970 (UNIX timet) */
-  t -= SECS_1970_TO_2000;  // bring to 2000 timestamp from 1970
-  ss = t % 60;
-  t /= 60;
-  mm = t % 60;
-  t /= 60;
-  hh            = t % 24;
-  uint16_t days = t / 24;
-  uint8_t  leap;
-  for (yOff = 0;; ++yOff) {
-    leap = yOff % 4 == 0;
-    if (days < (uint16_t)365 + leap) break;
-    days -= 365 + leap;
-  }  // of for-next each year
-  for (m = 1;; ++m) {
-    uint8_t daysPerMonth = pgm_read_byte(daysInMonth + m - 1);
-    if (leap && m == 2) ++daysPerMonth;
-    if (days < daysPerMonth) break;
-    days -= daysPerMonth;
-  }  // of for-next each month
-  d = days + 1;
+  t -= SECS_1970_TO_2000;           // bring to 2000 timestamp from 1970
+  uint32_t secs = t % 86400;         // seconds of the day
+  hh            = secs / 3600;
+  mm            = secs / 60 % 60;
+  ss            = secs % 60;
+  uint32_t z    = t / 86400 + DAYS_1600_TO_2000;  // days since 1600-03-01, civil-from-days
+  uint32_t era  = z / DAYS_PER_ERA;               // 400 year era
+  uint32_t doe  = z - era * DAYS_PER_ERA;         // day of era 0-146096
+  uint32_t yoe  = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;  // year of era 0-399
+  uint32_t doy  = doe - (365 * yoe + yoe / 4 - yoe / 100);  // day of March-based year 0-365
+  uint32_t mp   = (5 * doy + 2) / 153;                      // March-based month 0-11
+  d             = doy - (153 * mp + 2) / 5 + 1;
+  m             = mp < 10 ? mp + 3 : mp - 9;
+  yOff          = yoe + era * 400 + (m <= 2) - 400;  // back from 1600 to a 2000 offset
 }  // of method DateTime()
 DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min,
                    uint8_t sec) {
@@ -244,9 +241,11 @@ bool MCP7940_Class::begin(const uint32_t i2cSpeed) const {
       @param[in] i2cSpeed defaults to I2C_STANDARD_MODE, otherwise use speed in Herz
       @return    true if successfully started communication, otherwise false
   */
+  invalidateRegisterCache();               // Device may have lost power since the last call
   Wire.begin();                             // Start I2C as master device
   Wire.setClock(i2cSpeed);                  // Set the I2C bus speed
   Wire.beginTransmission(MCP7940_ADDRESS);  // Address the MCP7940
+  _i2cTransactions++;                       // Count the probe
   if (Wire.endTransmission() == 0)          // If there a device present
   {
     clearRegisterBit(MCP7940_RTCHOUR, MCP7940_12_24);  // Use 24 hour clock
@@ -262,6 +261,10 @@ uint8_t MCP7940_Class::readByte(const uint8_t addr) const {
       @param[in] addr I2C device register address to read from
       @return    Byte read from the I2C device
   */
+  int8_t index = cacheIndex(addr, 0xFF);  // Whole register known to the cache?
+  if (index >= 0) {
+    return _cache[index];
+  }  // of if-then cache hit
   uint8_t dataByte{0};
   I2C_read(addr, dataByte);
   return dataByte;
@@ -300,8 +303,51 @@ uint8_t MCP7940_Class::readRegisterBit(const uint8_t reg, const uint8_t b) const
       @param[in] b        Bit (0-7) to read
       @return    0 for "false" and 1 for "true"
    */
+  int8_t index = cacheIndex(reg, 1 << b);  // Software-owned bit known to the cache?
+  if (index >= 0) {
+    return bitRead(_cache[index], b);
+  }  // of if-then cache hit
   return bitRead(readByte(reg), b);
 }  // of method readRegisterBit()
+int8_t MCP7940_Class::cacheIndex(const uint8_t reg, const uint8_t bits) const {
+  /*!
+      @brief     Find the cache slot that can answer a read of the given register bits
+      @param[in] reg  Register address
+      @param[in] bits Bitmask of the bits needed
+      @return    Cache slot index, or -1 if the bus has to be read
+   */
+  if (!_cacheEnabled) {
+    return -1;
+  }  // of if-then cache off
+  for (uint8_t i = 0; i < MCP7940_CACHE_SIZE; i++) {
+    if (pgm_read_byte(cachedRegister + i) == reg) {
+      if (bitRead(_cacheValid, i) && (pgm_read_byte(cachedMask + i) & bits) == bits) {
+        return i;
+      }  // of if-then cached and all bits are software owned
+      return -1;
+    }  // of if-then register found
+  }    // of for-next each cached register
+  return -1;
+}  // of method cacheIndex()
+void MCP7940_Class::cacheUpdate(const uint8_t address, const uint8_t* data,
+                                const uint8_t length) const {
+  /*!
+      @brief     Store the bytes of a successful transfer into any cached registers they cover
+      @details   Called by I2C_read() and I2C_write(), so every path that touches a cached register
+                 keeps the cache coherent. Bits the device changes by itself are stored too but are
+                 masked out by cacheIndex() when answering reads.
+      @param[in] address First register address transferred
+      @param[in] data    Bytes transferred
+      @param[in] length  Number of bytes transferred
+   */
+  for (uint8_t i = 0; i < MCP7940_CACHE_SIZE; i++) {
+    uint8_t reg = pgm_read_byte(cachedRegister + i);
+    if (reg >= address && reg < address + length) {
+      _cache[i] = data[reg - address];
+      bitSet(_cacheValid, i);
+    }  // of if-then register in transferred range
+  }    // of for-next each cached register
+}  // of method cacheUpdate()
 uint8_t MCP7940_Class::bcd2int(const uint8_t bcd) const {
   /*!
       @brief     converts a BCD encoded value into number representation
@@ -419,19 +465,36 @@ void MCP7940_Class::adjust() {
 void MCP7940_Class::adjust(const DateTime& dt) {
   /*!
      @brief   sets the current date/time (overloaded)
-     @details This is an overloaded function. Set to the DateTime class instance value. The
-     oscillator is stopped during the process and is restarted upon completion.
-  */
-  deviceStop();  // Stop the oscillator
-  I2C_write(MCP7940_RTCSEC, int2bcd(dt.second()));
-  I2C_write(MCP7940_RTCMIN, int2bcd(dt.minute()));
-  I2C_write(MCP7940_RTCHOUR, int2bcd(dt.hour()));
-  weekdayWrite(dt.dayOfTheWeek());                        // Update the weekday
-  I2C_write(MCP7940_RTCDATE, int2bcd(dt.day()));          // Write the day of month
-  I2C_write(MCP7940_RTCMTH, int2bcd(dt.month()));         // Month, ignore R/O leapyear bit
-  I2C_write(MCP7940_RTCYEAR, int2bcd(dt.year() - 2000));  // Write the year
-  deviceStart();                                          // Restart the oscillator
-  _SetUnixTime = dt.unixtime();                           // Store time of last change
+     @details This is an overloaded function. Set to the DateTime class instance value. The datasheet
+     requires a running oscillator to be stopped (ST cleared and OSCRUN seen low) before new values
+     are loaded, so that is only done when OSCRUN is set. RTCSEC..RTCYEAR are then written in one
+     auto-incrementing block with ST set, which restarts the oscillator in the same transfer. The
+     RTCWKDAY control bits (VBATEN, PWRFAIL) are carried over from the initial read. If that read
+     fails nothing is written, as the zeroed bits would clear VBATEN, and getI2CError() tells why.
+     The time spent blocked is available from getAdjustMicros().
+     @param[in] dt DateTime value to set the clock to
+  */
+  uint32_t startMicros = micros();
+  uint8_t  status[MCP7940_RTCWKDAY + 1]{0};  // RTCSEC..RTCWKDAY
+  I2C_read(MCP7940_RTCSEC, status);
+  if (_i2cError != 0) return;  // Leave the clock and VBATEN as they are
+  if (bitRead(status[MCP7940_RTCWKDAY], MCP7940_OSCRUN)) {             // Oscillator is running
+    I2C_write(MCP7940_RTCSEC, (uint8_t)(status[0] & ~(1 << MCP7940_ST)));  // clear the ST bit
+    for (uint8_t j = 0; j < 255; j++) {  // Wait for OSCRUN to clear, each read takes >200us
+      if (!readRegisterBit(MCP7940_RTCWKDAY, MCP7940_OSCRUN)) break;
+    }  // of for-next oscillator loop
+  }    // of if-then oscillator running
+  uint8_t timeBuffer[MCP7940_RTCYEAR + 1] = {
+      (uint8_t)(int2bcd(dt.second()) | (1 << MCP7940_ST)),  // RTCSEC, restart oscillator
+      int2bcd(dt.minute()),                                 // RTCMIN
+      int2bcd(dt.hour()),                                   // RTCHOUR, 12_24 clear for 24 hour
+      (uint8_t)((status[MCP7940_RTCWKDAY] & B11111000) | (dt.dayOfTheWeek() & 0x07)),  // RTCWKDAY
+      int2bcd(dt.day()),                                    // RTCDATE
+      int2bcd(dt.month()),                                  // RTCMTH, ignore R/O leapyear bit
+      int2bcd(dt.year() - 2000)};                           // RTCYEAR
+  I2C_write(MCP7940_RTCSEC, timeBuffer);
+  _SetUnixTime  = dt.unixtime();          // Store time of last change
+  _adjustMicros = micros() - startMicros;  // Store time spent blocked
 }  // of method adjust
 uint8_t MCP7940_Class::weekdayRead() const {
   /*!
@@ -514,14 +577,27 @@ int8_t MCP7940_Class::calibrate(const DateTime& dt) {
   trim = constrain(trim, -127, 127);   // Clamp to value range
   return calibrate((const int8_t)trim);
 }  // of method calibrate()
-int8_t MCP7940_Class::calibrate(const float fMeas) const {
+int8_t MCP7940_Class::calibrate(const float fMeas) {
   /*!
       @brief   Calibrate the MCP7940 (overloaded)
-      @details When called with one floating point value then that is used as the measured frequency
+      @details When called with one floating point value then that is used as the measured frequency.
+      The value is converted to millihertz once and the trim is computed in integer math
       @param[in] fMeas Measured frequency in Herz
       @return  Returns the new trim value
   */
-  int16_t  trim   = getCalibrationTrim();  // Get the current trim
+  uint32_t milliHz = fMeas > 0 ? (uint32_t)(fMeas * 1000.0f + 0.5f) : 0;  // Round to nearest mHz
+  return calibrateMilliHz(milliHz);
+}  // of method calibrate()
+int8_t MCP7940_Class::calibrateMilliHz(const uint32_t fMeasMilliHz) {
+  /*!
+      @brief   Calibrate the MCP7940 from a measured frequency in millihertz
+      @details Integer version of the datasheet formula trim += (fMeas - fIdeal) * (32768 / fIdeal)
+      * 60 / 2. Both sides are scaled by fIdeal * 1000 so the only division is the last one, which
+      truncates toward zero exactly like the float to integer conversion did
+      @param[in] fMeasMilliHz Measured frequency in millihertz
+      @return  Returns the new trim value
+  */
+  int32_t  trim   = getCalibrationTrim();  // Get the current trim
   uint32_t fIdeal = getSQWSpeed();         // read the current SQW Speed code
   switch (fIdeal)                          // set variable to real SQW speed
   {
@@ -542,17 +618,19 @@ int8_t MCP7940_Class::calibrate(const float fMeas) const {
       trim   = 0;  // Trim is ignored on 32KHz signal
       break;
   }  // of switch SQWSpeed value
-  trim +=
-      ((fMeas - (float)fIdeal) * (32768.0 / fIdeal) * 60.0) / 2.0;  // Use formula from datasheet
-  if (trim > 127)  // Force number ppm to be in range
+  const int64_t scale = (int64_t)fIdeal * 1000;                         // fIdeal in mHz
+  int64_t       delta = (int64_t)fMeasMilliHz - scale;                  // Deviation in mHz
+  int64_t       total = (int64_t)trim * scale + delta * (32768L * 30);  // trim * scale + delta * 32768 * 60 / 2
+  total /= scale;
+  if (total > 127)  // Force number ppm to be in range
   {
-    trim = 127;
-  } else if (trim < -127) {
-    trim = -127;
-  }                                             // of if-then-else trim out of range
-  int8_t returnTrim = calibrate((int8_t)trim);  // Set the new trim value
+    total = 127;
+  } else if (total < -127) {
+    total = -127;
+  }                                              // of if-then-else trim out of range
+  int8_t returnTrim = calibrate((int8_t)total);  // Set the new trim value
   return (returnTrim);
-}  // of method calibrate()
+}  // of method calibrateMilliHz()
 int8_t MCP7940_Class::calibrateOrAdjust(const DateTime& dt) {
   /*!
     @brief   Calibrate the MCP7940 if the ppm deviation is < 130 and > -130 else Adjust the
@@ -607,6 +685,69 @@ uint32_t MCP7940_Class::getSetUnixTime() const {
   */
   return _SetUnixTime;
 }
+void MCP7940_Class::setRegisterCache(const bool state) const {
+  /*!
+    @brief     Turn the shadow register cache on or off
+    @details   With the cache on, the last known value of CONTROL and OSCTRIM and the software-owned
+    bits of ALM0WKDAY, ALM1WKDAY and RTCWKDAY (alarm mask, ALMPOL, VBATEN) are kept in memory. Bit
+    changes on CONTROL and OSCTRIM become a single write and getters such as getAlarmState(),
+    getSQWSpeed() and getBattery() need no bus traffic once the register has been seen. Hardware
+    flags (ALMxIF, OSCRUN, PWRFAIL) are always read from the device. The cache is cleared by begin()
+    and whenever getPowerFail() reports a power failure.
+    @param[in] state True to use the cache, false to always read the device
+  */
+  if (_cacheEnabled != state) {
+    invalidateRegisterCache();
+  }  // of if-then state changes
+  _cacheEnabled = state;
+}  // of method setRegisterCache()
+void MCP7940_Class::invalidateRegisterCache() const {
+  /*!
+    @brief   Forget all cached register values, the next access reads the device
+  */
+  _cacheValid = 0;
+}  // of method invalidateRegisterCache()
+uint32_t MCP7940_Class::getAdjustMicros() const {
+  /*!
+    @brief   Get the time the last adjust() call blocked for
+    @return  Duration of the last adjust() in microseconds
+  */
+  return _adjustMicros;
+}  // of method getAdjustMicros()
+uint32_t MCP7940_Class::getI2CTransactions() const {
+  /*!
+    @brief   Get the number of I2C transfers issued since the last resetI2CStats()
+    @details Every START..STOP on the bus counts once, so a register read (address write plus
+    block read) counts as two and a register write as one. Comparing the value before and after an
+    API call gives its bus cost.
+    @return  Number of I2C transfers
+  */
+  return _i2cTransactions;
+}  // of method getI2CTransactions()
+uint32_t MCP7940_Class::getI2CBytes() const {
+  /*!
+    @brief   Get the number of bytes moved over I2C since the last resetI2CStats()
+    @return  Number of data bytes including register address bytes, excluding device address
+  */
+  return _i2cBytes;
+}  // of method getI2CBytes()
+uint8_t MCP7940_Class::getI2CError() const {
+  /*!
+    @brief   Get the status of the last I2C transfer
+    @details Transfers larger than the Wire buffer are split into chunks and stop at the first chunk
+    that fails, this returns that chunk's Wire.endTransmission() code, or MCP7940_I2C_SHORT_READ
+    if the device returned fewer bytes than requested.
+    @return  0 if the last transfer succeeded, otherwise the error code
+  */
+  return _i2cError;
+}  // of method getI2CError()
+void MCP7940_Class::resetI2CStats() const {
+  /*!
+    @brief   Reset the I2C transfer and byte counters
+  */
+  _i2cTransactions = 0;
+  _i2cBytes        = 0;
+}  // of method resetI2CStats()
 int8_t MCP7940_Class::getCalibrationTrim() const {
   /*!
       @brief   Return the TRIMVAL trim value
@@ -669,33 +810,18 @@ bool MCP7940_Class::setAlarm(const uint8_t alarmNumber, const uint8_t alarmType,
      register(s)\n
                6. Enable the alarm module by setting the ALMxEN bit\n
                There are two ALMPOL bits - one in the ALM0WKDAY register which can be written, one
-     in the ALM1WKDAY register which is read-only and reflects the value of the ALMPOL in ALM0WKDAY.
+     in the ALM1WKDAY register which is read-only and reflects the value of the ALMPOL in ALM0WKDAY.\n
+               The update goes through MCP7940_Transaction: the oscillator state, CONTROL and the
+     ALMPOL/ALMxIF bits come from one block read and the contiguous ALMxSEC..ALMxMTH registers are
+     loaded in one auto-incrementing write, so an alarm costs at most 5 I2C transfers.
       @param[in] alarmNumber Alarm 0 or Alarm 1
       @param[in] alarmType   Alarm type from 0 to 7, see detailed description
       @param[in] dt          DateTime alarm value used to set the alarm
       @param[in] state       Alarm state to set to (0 for "off" and 1 for "on")
       @return  Returns true for success otherwise false
   */
-  if (alarmNumber < 2 && alarmType < 8 && alarmType != 5 && alarmType != 6 &&
-      deviceStart()) {  // if parameters and oscillator OK
-    clearRegisterBit(MCP7940_CONTROL,
-                     alarmNumber ? MCP7940_ALM1EN : MCP7940_ALM0EN);  // Turn off the alarm
-    uint8_t offset        = 7 * alarmNumber;                          // Offset to be applied
-    uint8_t wkdayRegister = readByte(MCP7940_ALM0WKDAY + offset);     // Load register to memory
-    wkdayRegister &=
-        ((1 << MCP7940_ALM0IF) | (1 << MCP7940_ALMPOL));        // Keep ALMPOL and ALMxIF bits
-    wkdayRegister |= alarmType << 4;                            // Set 3 bits from alarmType
-    wkdayRegister |= (dt.dayOfTheWeek() & 0x07);                // Set 3 bits for dow from date
-    I2C_write(MCP7940_ALM0WKDAY + offset, wkdayRegister);       // Write alarm mask
-    I2C_write(MCP7940_ALM0SEC + offset, int2bcd(dt.second()));  // Write seconds, keep device off
-    I2C_write(MCP7940_ALM0MIN + offset, int2bcd(dt.minute()));  // Write the minutes value
-    I2C_write(MCP7940_ALM0HOUR + offset, int2bcd(dt.hour()));   // Also re-sets the 24Hour clock on
-    I2C_write(MCP7940_ALM0DATE + offset, int2bcd(dt.day()));    // Write the day of month
-    I2C_write(MCP7940_ALM0MTH + offset, int2bcd(dt.month()));   // Month, ignore R/O leap-year bit
-    setAlarmState(alarmNumber, state);                          // Set the requested alarm to state
-    return true;
-  }              // of if-then alarmNumber and alarmType are valid and device running
-  return false;  // error if we get here
+  MCP7940_Transaction transaction(*this);  // Batch the register edits
+  return transaction.setAlarm(alarmNumber, alarmType, dt, state) && transaction.commit();
 }  // of method setAlarm()
 void MCP7940_Class::setAlarmPolarity(const bool polarity) const {
   /*!
@@ -787,6 +913,27 @@ bool MCP7940_Class::isAlarm(const uint8_t alarmNumber) const {
   return readRegisterBit(alarmNumber ? MCP7940_ALM1WKDAY : MCP7940_ALM0WKDAY,
                          MCP7940_ALM0IF);  // Get alarm state
 }  // of method isAlarm()
+uint8_t MCP7940_Class::getAlarmStatus() const {
+  /*!
+      @brief   Return the triggered and enabled state of both alarms with a single I2C read
+      @details CONTROL (0x07) through ALM1WKDAY (0x14) are contiguous, so one block read returns
+     both ALMxEN bits and both ALMxIF flags instead of one transaction per bit
+      @return  Bitmask of MCP7940_ALM0IF_STATUS, MCP7940_ALM1IF_STATUS, MCP7940_ALM0EN_STATUS and
+     MCP7940_ALM1EN_STATUS, 0 if the read failed
+  */
+  uint8_t readBuffer[MCP7940_ALM1WKDAY - MCP7940_CONTROL + 1];  // CONTROL..ALM1WKDAY
+  uint8_t status{0};
+  if (I2C_read(MCP7940_CONTROL, readBuffer) == sizeof(readBuffer)) {
+    uint8_t control = readBuffer[0];
+    bitWrite(status, MCP7940_ALM0IF_STATUS,
+             bitRead(readBuffer[MCP7940_ALM0WKDAY - MCP7940_CONTROL], MCP7940_ALM0IF));
+    bitWrite(status, MCP7940_ALM1IF_STATUS,
+             bitRead(readBuffer[MCP7940_ALM1WKDAY - MCP7940_CONTROL], MCP7940_ALM1IF));
+    bitWrite(status, MCP7940_ALM0EN_STATUS, bitRead(control, MCP7940_ALM0EN));
+    bitWrite(status, MCP7940_ALM1EN_STATUS, bitRead(control, MCP7940_ALM1EN));
+  }  // of if-then read successful
+  return status;
+}  // of method getAlarmStatus()
 uint8_t MCP7940_Class::getSQWSpeed() const {
   /*!
       @brief  returns the list value for the frequency of the square wave
@@ -872,6 +1019,9 @@ bool MCP7940_Class::getPowerFail() const {
      otherwise "false"
   */
   bool status = readRegisterBit(MCP7940_RTCWKDAY, MCP7940_PWRFAIL);
+  if (status) {
+    invalidateRegisterCache();  // Registers may have been reset while the power was out
+  }                             // of if-then power failure
   return status;
 }  // of method getPowerFail()
 bool MCP7940_Class::clearPowerFail() const {
@@ -882,3 +1032,202 @@ bool MCP7940_Class::clearPowerFail() const {
   I2C_write(MCP7940_RTCWKDAY, readByte(MCP7940_RTCWKDAY));
   return true;
 }  // of method clearPowerFail()
+/***************************************************************************************************
+** Implementation of MCP7940_Transaction                                                          **
+***************************************************************************************************/
+/*! Registers a transaction can batch, in the order of the _setBits and _clearBits slots */
+const uint8_t transactionRegister[3] PROGMEM = {MCP7940_CONTROL, MCP7940_ALM0WKDAY,
+                                                MCP7940_ALM1WKDAY};
+MCP7940_Transaction::MCP7940_Transaction(const MCP7940_Class& rtc) : _rtc(rtc) {
+  /*!
+   @brief     Class constructor, starts an empty transaction
+   @param[in] rtc Device the transaction will be committed to
+  */
+}  // of constructor
+int8_t MCP7940_Transaction::registerIndex(const uint8_t reg) const {
+  /*!
+   @brief     Return the edit slot for a register
+   @param[in] reg Register address
+   @return    Slot 0-2, or -1 if the register cannot be batched
+  */
+  for (uint8_t i = 0; i < 3; i++) {
+    if (pgm_read_byte(transactionRegister + i) == reg) return i;
+  }  // of for-next each batched register
+  return -1;
+}  // of method registerIndex()
+bool MCP7940_Transaction::writeRegisterBit(const uint8_t reg, const uint8_t b,
+                                           const bool bitvalue) {
+  /*!
+   @brief     Queue setting or clearing a bit in CONTROL, ALM0WKDAY or ALM1WKDAY
+   @details   A later edit of the same bit replaces an earlier one
+   @param[in] reg      Register to edit
+   @param[in] b        Bit (0-7) to edit
+   @param[in] bitvalue boolean with "true" for 1 and "false" for 0
+   @return    False if the register cannot be batched, otherwise true
+  */
+  int8_t index = registerIndex(reg);
+  if (index < 0 || b > 7) {
+    return false;
+  }  // of if-then unsupported register
+  if (bitvalue) {
+    bitSet(_setBits[index], b);
+    bitClear(_clearBits[index], b);
+  } else {
+    bitClear(_setBits[index], b);
+    bitSet(_clearBits[index], b);
+  }  // of if-then-else set or clear
+  return true;
+}  // of method writeRegisterBit()
+bool MCP7940_Transaction::setAlarm(const uint8_t alarmNumber, const uint8_t alarmType,
+                                   const DateTime& dt, const bool state) {
+  /*!
+   @brief     Queue loading a new alarm match value, see MCP7940_Class::setAlarm()
+   @param[in] alarmNumber Alarm 0 or Alarm 1
+   @param[in] alarmType   Alarm type from 0 to 7, 5 and 6 are invalid
+   @param[in] dt          DateTime alarm value used to set the alarm
+   @param[in] state       Alarm state to set to (0 for "off" and 1 for "on")
+   @return    False if the parameters are out of range, otherwise true
+  */
+  if (alarmNumber > 1 || alarmType > 7 || alarmType == 5 || alarmType == 6) {
+    return false;
+  }  // of if-then invalid alarm
+  _alarm[alarmNumber][0] = _rtc.int2bcd(dt.second());                           // ALMxSEC
+  _alarm[alarmNumber][1] = _rtc.int2bcd(dt.minute());                           // ALMxMIN
+  _alarm[alarmNumber][2] = _rtc.int2bcd(dt.hour());                             // ALMxHOUR, 24h
+  _alarm[alarmNumber][3] = (alarmType << 4) | (dt.dayOfTheWeek() & 0x07);       // ALMxWKDAY
+  _alarm[alarmNumber][4] = _rtc.int2bcd(dt.day());                              // ALMxDATE
+  _alarm[alarmNumber][5] = _rtc.int2bcd(dt.month());                            // ALMxMTH
+  bitSet(_alarmStaged, alarmNumber);
+  return setAlarmState(alarmNumber, state);
+}  // of method setAlarm()
+bool MCP7940_Transaction::setAlarmState(const uint8_t alarmNumber, const bool state) {
+  /*!
+   @brief     Queue turning an alarm on or off
+   @param[in] alarmNumber Alarm number 0 or 1
+   @param[in] state       State to the set the alarm to
+   @return    False if the alarmNumber is out of range, otherwise true
+  */
+  if (alarmNumber > 1) {
+    return false;
+  }  // of if-then a bad alarm number
+  return writeRegisterBit(MCP7940_CONTROL, alarmNumber ? MCP7940_ALM1EN : MCP7940_ALM0EN, state);
+}  // of method setAlarmState()
+bool MCP7940_Transaction::clearAlarm(const uint8_t alarmNumber) {
+  /*!
+   @brief     Queue clearing an alarm flag
+   @param[in] alarmNumber Alarm number 0 or 1
+   @return    False if the alarmNumber is out of range, otherwise true
+  */
+  if (alarmNumber > 1) {
+    return false;
+  }  // of if-then a bad alarm number
+  return writeRegisterBit(alarmNumber ? MCP7940_ALM1WKDAY : MCP7940_ALM0WKDAY, MCP7940_ALM0IF,
+                          false);
+}  // of method clearAlarm()
+bool MCP7940_Transaction::writeByte(const uint8_t reg, const uint8_t value) const {
+  /*!
+   @brief     Write one register
+   @param[in] reg   Register address
+   @param[in] value Value to write
+   @return    True if the device acknowledged the write
+  */
+  return _rtc.I2C_write(reg, value) == sizeof(value);
+}  // of method writeByte()
+bool MCP7940_Transaction::commit() {
+  /*!
+   @brief   Apply all queued edits to the device
+   @details One block read of RTCSEC..ALM1MTH supplies the oscillator state and every register the
+   transaction can touch. The oscillator is started if an alarm is loaded while it is stopped. Alarms
+   being loaded are first disabled if they are enabled, then each alarm bank is written in one
+   transfer (or just ALMxWKDAY for flag/mask edits) and CONTROL is written last. Registers that do
+   not change are not written. On a failed write the registers written so far are restored.
+   @return  True if all writes succeeded
+  */
+  uint8_t image[MCP7940_ALM1MTH + 1];  // RTCSEC..ALM1MTH
+  if (_rtc.I2C_read(MCP7940_RTCSEC, image) != sizeof(image)) {
+    return false;
+  }  // of if-then read failed
+  if (_alarmStaged && (!bitRead(image[MCP7940_RTCSEC], MCP7940_ST) ||
+                       !bitRead(image[MCP7940_RTCWKDAY], MCP7940_OSCRUN))) {
+    if (!_rtc.deviceStart()) {
+      return false;
+    }  // of if-then oscillator did not start
+  }    // of if-then alarm needs a running oscillator
+  uint8_t original[3], target[3];
+  for (uint8_t i = 0; i < 3; i++) {
+    original[i] = image[pgm_read_byte(transactionRegister + i)];
+    target[i]   = (original[i] | _setBits[i]) & ~_clearBits[i];
+  }  // of for-next each batched register
+  uint8_t reloadEnable{0};  // ALMxEN bits of alarms being loaded
+  if (bitRead(_alarmStaged, 0)) bitSet(reloadEnable, MCP7940_ALM0EN);
+  if (bitRead(_alarmStaged, 1)) bitSet(reloadEnable, MCP7940_ALM1EN);
+  uint8_t written{0};  // Bit 0 CONTROL, bit 1 alarm 0, bit 2 alarm 1
+  uint8_t control = original[0];
+  if (control & reloadEnable) {  // Turn off alarms while their match value is loaded
+    control &= ~reloadEnable;
+    if (!writeByte(MCP7940_CONTROL, control)) {
+      rollback(image, target, reloadEnable, written);
+      return false;
+    }  // of if-then write failed
+    bitSet(written, 0);
+  }  // of if-then alarms enabled
+  for (uint8_t alarmNumber = 0; alarmNumber < 2; alarmNumber++) {
+    uint8_t offset = 7 * alarmNumber;
+    bool    ok     = true;
+    if (bitRead(_alarmStaged, alarmNumber)) {
+      uint8_t bank[6];
+      memcpy(bank, _alarm[alarmNumber], sizeof(bank));
+      bank[3] |= target[1 + alarmNumber] &
+                 ((1 << MCP7940_ALM0IF) | (1 << MCP7940_ALMPOL));  // Keep ALMPOL and ALMxIF bits
+      ok = _rtc.I2C_write(MCP7940_ALM0SEC + offset, bank) == sizeof(bank);
+    } else if (target[1 + alarmNumber] != original[1 + alarmNumber]) {
+      ok = writeByte(MCP7940_ALM0WKDAY + offset, target[1 + alarmNumber]);
+    } else {
+      continue;
+    }  // of if-then-else bank, flag edit or nothing
+    if (!ok) {
+      rollback(image, target, reloadEnable, written);
+      return false;
+    }  // of if-then write failed
+    bitSet(written, 1 + alarmNumber);
+  }  // of for-next each alarm
+  if (target[0] != control) {
+    if (!writeByte(MCP7940_CONTROL, target[0])) {
+      rollback(image, target, reloadEnable, written);
+      return false;
+    }  // of if-then write failed
+  }    // of if-then CONTROL changes
+  return true;
+}  // of method commit()
+void MCP7940_Transaction::rollback(const uint8_t* image, const uint8_t* target,
+                                   const uint8_t reloadEnable, const uint8_t written) const {
+  /*!
+   @brief     Put the registers written by a failed commit() back
+   @details   Alarms being loaded are kept disabled while their registers are restored and CONTROL
+              is restored last. This is best effort, the bus has just failed a write.
+   @param[in] image        RTCSEC..ALM1MTH as read at the start of the commit
+   @param[in] target       CONTROL, ALM0WKDAY, ALM1WKDAY the commit was writing
+   @param[in] reloadEnable ALMxEN bits of the alarms being loaded
+   @param[in] written      Bit 0 CONTROL, bit 1 alarm 0, bit 2 alarm 1 already written
+  */
+  if (written & 0x06) {
+    writeByte(MCP7940_CONTROL, image[MCP7940_CONTROL] & ~reloadEnable);
+  }  // of if-then alarm registers were written
+  for (uint8_t alarmNumber = 0; alarmNumber < 2; alarmNumber++) {
+    if (!bitRead(written, 1 + alarmNumber)) continue;
+    uint8_t offset = 7 * alarmNumber;
+    uint8_t bank[6];
+    memcpy(bank, image + MCP7940_ALM0SEC + offset, sizeof(bank));
+    if (!bitRead(target[1 + alarmNumber], MCP7940_ALM0IF)) {
+      bitClear(bank[3], MCP7940_ALM0IF);  // Never re-raise a flag the transaction cleared
+    }                                     // of if-then flag was being cleared
+    if (bitRead(_alarmStaged, alarmNumber)) {
+      _rtc.I2C_write(MCP7940_ALM0SEC + offset, bank);
+    } else {
+      writeByte(MCP7940_ALM0WKDAY + offset, bank[3]);
+    }  // of if-then-else whole bank or flags only
+  }    // of for-next each alarm written
+  if (written) {
+    writeByte(MCP7940_CONTROL, image[MCP7940_CONTROL]);
+  }  // of if-then anything was written
+}  // of method rollback()
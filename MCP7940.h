@@ -77,6 +77,7 @@ Version| Date       | Developer           | Comments
 
 #include "Arduino.h"  // Arduino data type definitions
 #include "Wire.h"     // Standard I2C "Wire" library
+#include "I2CBus.h"   // Keeps the current sampler off the bus during a transfer
 #ifndef MCP7940_h
 /** @brief  Guard code definition */
 #define MCP7940_h  // Define the name inside guard code
@@ -84,6 +85,7 @@ Version| Date       | Developer           | Comments
 ** Declare classes used in within the class                                                       **
 ***************************************************************************************************/
 class TimeSpan;
+class MCP7940_Transaction;
 /***************************************************************************************************
 ** Declare constants used in the class                                                            **
 ***************************************************************************************************/
@@ -148,6 +150,12 @@ const uint8_t  MCP7940_SIGN{7};               ///< OSCTRIM register
 const uint8_t  MCP7940_ALMPOL{7};             ///< ALM0WKDAY register
 const uint8_t  MCP7940_ALM0IF{3};             ///< ALM0WKDAY register
 const uint8_t  MCP7940_ALM1IF{3};             ///< ALM1WKDAY register
+const uint8_t  MCP7940_ALM0IF_STATUS{0};      ///< getAlarmStatus() bit, alarm 0 triggered
+const uint8_t  MCP7940_ALM1IF_STATUS{1};      ///< getAlarmStatus() bit, alarm 1 triggered
+const uint8_t  MCP7940_ALM0EN_STATUS{2};      ///< getAlarmStatus() bit, alarm 0 enabled
+const uint8_t  MCP7940_ALM1EN_STATUS{3};      ///< getAlarmStatus() bit, alarm 1 enabled
+const uint8_t  MCP7940_CACHE_SIZE{5};         ///< Registers held in the shadow register cache
+const uint8_t  MCP7940_I2C_SHORT_READ{5};     ///< getI2CError() code, device returned fewer bytes
 const uint32_t SECS_1970_TO_2000{946684800};  ///< Seconds between year 1970 and 2000
 
 class DateTime {
@@ -237,7 +245,8 @@ class MCP7940_Class {
   int8_t   calibrate() const;
   int8_t   calibrate(const int8_t newTrim);
   int8_t   calibrate(const DateTime& dt);
-  int8_t   calibrate(const float fMeas) const;
+  int8_t   calibrate(const float fMeas);
+  int8_t   calibrateMilliHz(const uint32_t fMeasMilliHz);
   int8_t   getCalibrationTrim() const;
   uint8_t  weekdayRead() const;
   uint8_t  weekdayWrite(const uint8_t dow) const;
@@ -251,6 +260,7 @@ class MCP7940_Class {
   bool     setAlarmState(const uint8_t alarmNumber, const bool state) const;
   bool     getAlarmState(const uint8_t alarmNumber) const;
   bool     isAlarm(const uint8_t alarmNumber) const;
+  uint8_t  getAlarmStatus() const;
   uint8_t  getSQWSpeed() const;
   bool     setSQWSpeed(uint8_t frequency, bool state = true) const;
   bool     setSQWState(const bool state) const;
@@ -265,6 +275,13 @@ class MCP7940_Class {
   int32_t  getPPMDeviation(const DateTime& dt) const;
   void     setSetUnixTime(uint32_t aTime);
   uint32_t getSetUnixTime() const;
+  uint32_t getAdjustMicros() const;
+  void     setRegisterCache(const bool state) const;
+  void     invalidateRegisterCache() const;
+  uint32_t getI2CTransactions() const;
+  uint32_t getI2CBytes() const;
+  uint8_t  getI2CError() const;
+  void     resetI2CStats() const;
 
   /*************************************************************************************************
   ** Template functions definitions are done in the header file                                   **
@@ -279,7 +296,7 @@ class MCP7940_Class {
      @details   As a template it can support compile-time data type definitions
      @param[in] addr Memory address
      @param[in] value    Data Type "T" to read
-     @return    Pointer to return data structure
+     @return    Number of bytes read, less than sizeof(T) on error
     */
     return I2C_read((addr % 64) + MCP7940_RAM_ADDRESS, value);
     // return (i);
@@ -293,11 +310,18 @@ class MCP7940_Class {
      @param[in] value Data Type "T" to write
      @return    True if successful, otherwise false
      */
-    uint8_t i = I2C_write((addr % 64) + MCP7940_RAM_ADDRESS, value);
-    return i;
+    return I2C_write((addr % 64) + MCP7940_RAM_ADDRESS, value) == sizeof(T);
   }  // of method writeRAM()
  private:
-  uint32_t _SetUnixTime{0};  ///< UNIX time when clock last set
+  friend class MCP7940_Transaction;       ///< Batched register updates use the I2C templates
+  uint32_t         _SetUnixTime{0};      ///< UNIX time when clock last set
+  uint32_t         _adjustMicros{0};     ///< Microseconds the last adjust() blocked for
+  mutable uint32_t _i2cTransactions{0};  ///< Number of I2C bus transfers (START..STOP)
+  mutable uint32_t _i2cBytes{0};         ///< Number of bytes moved, register address included
+  mutable uint8_t  _i2cError{0};         ///< Wire status of the last transfer, 0 on success
+  mutable bool     _cacheEnabled{false};  ///< Shadow register cache switched on
+  mutable uint8_t  _cacheValid{0};        ///< Bit per cache slot holding a known register value
+  mutable uint8_t  _cache[MCP7940_CACHE_SIZE]{0};  ///< Last value read from or written to the device
   /*************************************************************************************************
   ** Template functions definitions are done in the header file                                   **
   ** ============================================================================================ **
@@ -309,43 +333,78 @@ class MCP7940_Class {
   uint8_t I2C_read(const uint8_t address, T& value) const {
     /*!
     @brief     Template for I2C_read() generic read function
-    @details   The template supports reading any number of bytes from a structure. The size of the
-               structure is determined by the template and determines how often the main loop is
-               entered.
+    @details   The template supports reading any number of bytes from a structure. The register
+               address is sent once and the data is then fetched in reads of up to BUFFER_LENGTH
+               bytes, relying on the MCP7940 address pointer to carry on where the last read
+               stopped. With the 128 byte ESP8266 buffer any register or SRAM block is one read.
+               A failed or short read stops the transfer and is kept in _i2cError.
     @param[in] device  I2C Device number
     @param[in] address Memory address to read from on device
     @param[in] value   Data Type "T" to read
-    @return    number of bytes read
+    @return    number of bytes read, less than sizeof(T) on error
    */
-    uint8_t i{0};                                    // return number of bytes read
-    Wire.beginTransmission(MCP7940_ADDRESS);         // Address the I2C device
-    Wire.write(address);                             // Send register address to read from
-    if (Wire.endTransmission() == 0) {               // Close transmission and check error code
-      Wire.requestFrom(MCP7940_ADDRESS, sizeof(T));  // Request a block of data
-      uint8_t* bytePtr = (uint8_t*)&value;           // Declare pointer to start of structure
-      for (i = 0; i < sizeof(T); i++) {              // Loop for each byte to be read
-        *bytePtr++ = Wire.read();                    // Read a byte
-      }                                              // of for-next each byte
-    }                                                // if-then success
-    return i;                                        // return number of bytes read
-  }                                                  // end of template method "I2C_read"
+    uint8_t  i{0};                                     // return number of bytes read
+    uint8_t* bytePtr = (uint8_t*)&value;               // Declare pointer to start of structure
+    I2CBusLock busLock;                                // Hold the bus for all chunks
+    Wire.beginTransmission(MCP7940_ADDRESS);           // Address the I2C device
+    Wire.write(address);                               // Send register address to read from
+    _i2cTransactions++;                                // Count the address write
+    _i2cBytes++;                                       // and the register address byte
+    _i2cError = Wire.endTransmission();                // Close transmission and save error code
+    while (_i2cError == 0 && i < sizeof(T)) {          // Loop for each chunk while no error
+      uint8_t chunk = sizeof(T) - i;                   // Bytes still to read
+      if (chunk > BUFFER_LENGTH) chunk = BUFFER_LENGTH;  // limited to the Wire buffer
+      uint8_t received = Wire.requestFrom(MCP7940_ADDRESS, chunk);  // Request a block of data
+      if (received > chunk) received = chunk;          // Never store more than was asked for
+      _i2cTransactions++;                              // Count the block read
+      _i2cBytes += received;                           // and the bytes read
+      for (uint8_t j = 0; j < received && i + j < sizeof(T); j++) {  // Each byte, never past value
+        bytePtr[i + j] = Wire.read();                  // Read a byte
+      }                                                // of for-next each byte
+      cacheUpdate(address + i, bytePtr + i, received);  // Refresh cached registers in range
+      i += received;                                   // Advance past the chunk
+      if (received != chunk) _i2cError = MCP7940_I2C_SHORT_READ;  // Device stopped early
+    }                                                  // of while-then more chunks
+    return i;                                          // return number of bytes read
+  }                                                    // end of template method "I2C_read"
   template <typename T>
   uint8_t I2C_write(const uint8_t address, const T& value) const {
     /*!
       @brief     Template for I2C_write() generic read function
       @details   The template supports writing any number of bytes into a structure. The size of the
-                 structure is determined by the template and determines how many bytes are written
+                 structure is determined by the template and determines how many bytes are written.
+                 Each transmission carries the register address followed by up to BUFFER_LENGTH - 1
+                 data bytes, so structures larger than the Wire buffer are written in chunks. The
+                 ESP8266 core buffer is 128 bytes, which takes the whole 64 byte SRAM in one write;
+                 chunking only starts on cores with smaller buffers, such as the 32 bytes of AVR.
+                 A chunk that runs past the end of the SRAM carries on at its start, as the device
+                 pointer does. The first failing chunk stops the transfer and its error is kept in
+                 _i2cError.
       @param[in] device  I2C Device number
       @param[in] address Memory address to write to on device
       @param[in] value   Data Type "T" to write
-      @return    number of bytes written
+      @return    number of bytes written, less than sizeof(T) on error
      */
-    Wire.beginTransmission(MCP7940_ADDRESS);   // Address the I2C device
-    Wire.write(address);                       // Send register address to read from
-    Wire.write((uint8_t*)&value, sizeof(T));   // write the data
-    uint8_t i = Wire.endTransmission();        // close transmission and save status
-    if (i == 0) i = sizeof(T);                 // return number of bytes on success
-    return i;                                  // return the number of bytes written
+    uint8_t        i{0};                         // return number of bytes written
+    const uint8_t* bytePtr = (const uint8_t*)&value;  // Declare pointer to start of structure
+    _i2cError = 0;                               // No error so far
+    I2CBusLock     busLock;                      // Hold the bus for all chunks
+    while (i < sizeof(T)) {                      // Loop for each chunk
+      uint8_t chunk = sizeof(T) - i;             // Bytes still to write
+      if (chunk > BUFFER_LENGTH - 1) chunk = BUFFER_LENGTH - 1;  // leave room for the address
+      uint8_t target = address + i;              // Register address of this chunk
+      if (address >= MCP7940_RAM_ADDRESS && target >= MCP7940_RAM_ADDRESS + 64) target -= 64;  // SRAM wrap
+      Wire.beginTransmission(MCP7940_ADDRESS);   // Address the I2C device
+      Wire.write(target);                        // Send register address to write to
+      Wire.write(bytePtr + i, chunk);            // write the data
+      _i2cError = Wire.endTransmission();        // close transmission and save status
+      _i2cTransactions++;                        // Count the transfer
+      _i2cBytes += chunk + 1;                    // and the bytes including register address
+      if (_i2cError != 0) break;                 // stop at the first failed chunk
+      cacheUpdate(target, bytePtr + i, chunk);   // refresh cached registers in range
+      i += chunk;                                // Advance past the chunk
+    }                                            // of while-then more chunks
+    return i;                                    // return the number of bytes written
   }                                            // end of template method "I2C_write()"
   uint8_t readByte(const uint8_t addr) const;  // Read 1 byte from address on I2C
   uint8_t bcd2int(const uint8_t bcd) const;    // convert BCD digits to integer
@@ -355,5 +414,39 @@ class MCP7940_Class {
   void    writeRegisterBit(const uint8_t reg, const uint8_t b,
                            bool bitvalue) const;                      // Clear a bit, values 0-7
   uint8_t readRegisterBit(const uint8_t reg, const uint8_t b) const;  // Read  a bit, values 0-7
+  int8_t  cacheIndex(const uint8_t reg, const uint8_t bits) const;  // Cache slot holding bits
+  void    cacheUpdate(const uint8_t address, const uint8_t* data,
+                      const uint8_t length) const;  // Store bytes transferred to/from device
 };                                                                    // of MCP7940 class definition
+class MCP7940_Transaction {
+  /*!
+   @class   MCP7940_Transaction
+   @brief   Batched update of the CONTROL and alarm registers
+   @details Collects bit edits to CONTROL, ALM0WKDAY and ALM1WKDAY and complete alarm settings
+            without touching the device. commit() then reads RTCSEC..ALM1MTH in one block, applies
+            all edits in memory and writes only the registers that change, with each alarm's
+            ALMxSEC..ALMxMTH bank in a single write. If a write fails the registers already written
+            are put back to their original values, except that alarm flags the transaction cleared
+            stay cleared so a stale alarm is never replayed.
+  */
+ public:
+  MCP7940_Transaction(const MCP7940_Class& rtc);
+  bool writeRegisterBit(const uint8_t reg, const uint8_t b, const bool bitvalue);
+  bool setAlarm(const uint8_t alarmNumber, const uint8_t alarmType, const DateTime& dt,
+                const bool state = true);
+  bool setAlarmState(const uint8_t alarmNumber, const bool state);
+  bool clearAlarm(const uint8_t alarmNumber);
+  bool commit();
+
+ private:
+  const MCP7940_Class& _rtc;               ///< Device the transaction is committed to
+  uint8_t              _setBits[3]{0};     ///< Bits to set in CONTROL, ALM0WKDAY, ALM1WKDAY
+  uint8_t              _clearBits[3]{0};   ///< Bits to clear in CONTROL, ALM0WKDAY, ALM1WKDAY
+  uint8_t              _alarmStaged{0};    ///< Bit per alarm with a new match value to load
+  uint8_t              _alarm[2][6]{{0}};  ///< ALMxSEC..ALMxMTH, WKDAY holds mask and dow only
+  int8_t               registerIndex(const uint8_t reg) const;  // Slot for a batched register
+  bool                 writeByte(const uint8_t reg, const uint8_t value) const;
+  void rollback(const uint8_t* image, const uint8_t* target, const uint8_t reloadEnable,
+                const uint8_t written) const;  // Undo the writes done so far
+};  // of MCP7940_Transaction class definition
 #endif
\ No newline at end of file
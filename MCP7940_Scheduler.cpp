@@ -1,14 +1,155 @@
 #include "MCP7940_Scheduler.h"
 #include <NTPClient.h>
 #include <WiFiUdp.h>
+#include <EEPROM.h>
+#include <algorithm>
 
 WiFiUDP ntpUDP;
 NTPClient timeClient(ntpUDP, NTP_SERVER);
 
-MCP7940Scheduler::MCP7940Scheduler() : timezoneOffset(5.5) , _nextDueAlarm(0){}
+MCP7940Scheduler::MCP7940Scheduler() : _nextDueAlarm(0), timezoneOffset(DEFAULT_TIMEZONE_MINUTES),
+    _anchorUnix(0), _anchorMillis(0), _lastUnix(0), _resyncInterval(CLOCK_RESYNC_INTERVAL), _clockValid(false),
+    _alarmFlags(0), _timestampUnix(0), _schedulesLoaded(false), _activeBank(1), _generation(0), _overflowPending(false),
+    _overflowPendingSince(0), _overflowChangedAt(0), _timelineLength(0), _timelineValid(false) {}
+
+// CRC-8 (polynomial 0x07) used to detect corruption of the in-RAM schedule copy
+static uint8_t crc8(const uint8_t* data, size_t length) {
+    uint8_t crc = 0;
+    while (length--) {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint8_t slotCrc(uint32_t record) {
+    return crc8(reinterpret_cast<const uint8_t*>(&record), sizeof(record));
+}
+
+static bool validSchedule(const ScheduleItem& item) {
+    return item.hour <= 23 && item.minute <= 59 && item.daysOfWeek <= 127;
+}
+
+static_assert(unpackSchedule(packSchedule({23, 59, SCHEDULE_DURATION_MAX, DOW_EVERYDAY, true})).duration_sec ==
+              SCHEDULE_DURATION_MAX, "Durations up to SCHEDULE_DURATION_MAX are kept in seconds");
+static_assert(unpackSchedule(packSchedule({0, 0, 65535, DOW_SUNDAY, false})).duration_sec == 65520,
+              "Longer durations are kept to the nearest minute");
+static_assert(validRecord(packSchedule({23, 59, 65535, DOW_EVERYDAY, true})), "Every valid schedule packs");
+#define SCHEDULE_LAYOUT_MAGIC 0xB6
+#define SCHEDULE_LAYOUT_VERSION 1
+#define LEGACY_SCHEDULES 10  // Raw ScheduleItem array stored at RTC RAM address 0 by older firmware
+
+// Header in front of each block of stored records, the CRC covers the header and the records
+struct ScheduleHeader {
+    uint8_t magic;
+    uint8_t version;
+    uint8_t generation;  // Incremented on every bank write, the newer valid bank wins
+    uint8_t crc;
+};
+
+// One of the two RTC RAM banks, a write always goes to the inactive bank so a brown-out
+// mid-write leaves the active bank intact
+struct ScheduleBank {
+    ScheduleHeader header;
+    uint32_t records[SRAM_SCHEDULES];
+};
+
+// The whole RTC RAM, read in one go at boot
+struct ScheduleSram {
+    ScheduleBank banks[2];
+};
+
+// Records that do not fit the RTC RAM
+struct ScheduleOverflow {
+    ScheduleHeader header;
+    uint32_t records[MAX_SCHEDULES - SRAM_SCHEDULES];
+};
+
+static_assert(sizeof(ScheduleSram) == 64, "Both banks must exactly fill the RTC RAM");
+static_assert(sizeof(ScheduleItem) * LEGACY_SCHEDULES <= 64, "Legacy image lives in the RTC RAM");
+static_assert(EEPROM_SIZE >= SCHEDULE_EEPROM_ADDR + sizeof(ScheduleOverflow), "Overflow records must fit the EEPROM");
+
+// CRC over a block with its CRC field taken as zero
+template <typename T>
+static uint8_t blockCrc(const T& block) {
+    T copy = block;
+    copy.header.crc = 0;
+    return crc8(reinterpret_cast<const uint8_t*>(&copy), sizeof(copy));
+}
+
+template <typename T>
+static bool blockValid(const T& block) {
+    return block.header.magic == SCHEDULE_LAYOUT_MAGIC &&
+           block.header.version == SCHEDULE_LAYOUT_VERSION &&
+           block.header.crc == blockCrc(block);
+}
+
+template <typename T>
+static void sealBlock(T& block, uint8_t generation) {
+    block.header.magic = SCHEDULE_LAYOUT_MAGIC;
+    block.header.version = SCHEDULE_LAYOUT_VERSION;
+    block.header.generation = generation;
+    block.header.crc = blockCrc(block);
+}
+
+// Index of the valid bank with the newer generation, or -1 if neither bank is valid
+static int8_t newestBank(const ScheduleSram& sram) {
+    bool valid0 = blockValid(sram.banks[0]);
+    bool valid1 = blockValid(sram.banks[1]);
+    if (valid0 && valid1) {
+        // Generations wrap, so compare the signed distance
+        int8_t age = sram.banks[0].header.generation - sram.banks[1].header.generation;
+        return age > 0 ? 0 : 1;
+    }
+    return valid0 ? 0 : (valid1 ? 1 : -1);
+}
+
+// RTC RAM that was never written, or was cleared, reads as one repeated byte
+static bool sramBlank(const ScheduleSram& sram) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&sram);
+    for (size_t i = 1; i < sizeof(sram); ++i) {
+        if (bytes[i] != bytes[0]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Recover the schedules of firmware that stored a raw ScheduleItem array, false if the
+// RTC RAM does not look like such an image. The old layout had no header, so every item must be
+// in range and at least one must be an enabled run that could have been set through the app.
+static bool migrateLegacy(const ScheduleSram& sram, uint32_t (&records)[MAX_SCHEDULES]) {
+    ScheduleItem legacy[LEGACY_SCHEDULES];
+    memcpy(legacy, &sram, sizeof(legacy));
+    bool anyRun = false;
+    for (int i = 0; i < LEGACY_SCHEDULES; ++i) {
+        uint8_t enabled;
+        memcpy(&enabled, &legacy[i].enabled, 1);
+        if (!validSchedule(legacy[i]) || enabled > 1) {
+            return false;
+        }
+        if (enabled && legacy[i].daysOfWeek != 0 && legacy[i].duration_sec != 0) {
+            anyRun = true;
+        }
+    }
+    if (!anyRun) {
+        return false;
+    }
+    memset(records, 0, sizeof(records));
+    for (int i = 0; i < LEGACY_SCHEDULES; ++i) {
+        records[i] = packSchedule(legacy[i]);
+    }
+    return true;
+}
 
 void MCP7940Scheduler::begin() {
     rtc.begin();
+    rtc.setRegisterCache(true);
+    if (!loadSchedules()) {
+        Serial.println("Could not read schedules from RTC RAM.");
+    }
     
     // ENABLE BATTERY BACKUP - Critical for retaining time/data during power failure
     rtc.setBattery(true);
@@ -29,38 +170,360 @@ void MCP7940Scheduler::begin() {
     }
 }
 
+void MCP7940Scheduler::setTimeZoneMinutes(int16_t offsetMinutes) {
+    timezoneOffset = offsetMinutes;
+}
+
 void MCP7940Scheduler::setTimeZone(float tzOffset) {
-    timezoneOffset = tzOffset;
+    setTimeZoneMinutes((int16_t)lroundf(tzOffset * 60));
 }
 
-float MCP7940Scheduler::getTimeZone() { return timezoneOffset; }
+int16_t MCP7940Scheduler::getTimeZoneMinutes() const { return timezoneOffset; }
+
+float MCP7940Scheduler::getTimeZone() { return timezoneOffset / 60.0f; }
 
 bool MCP7940Scheduler::updateTimeFromNTP() {
     timeClient.begin();
     if (timeClient.forceUpdate()) {
-        time_t ntpTime = timeClient.getEpochTime() + static_cast<uint32_t>(timezoneOffset * 3600);
+        time_t ntpTime = timeClient.getEpochTime() + (int32_t)timezoneOffset * 60;
         rtc.adjust(DateTime(ntpTime));
+        if (rtc.getI2CError() != 0) {
+            Serial.printf("RTC set failed, I2C error %u\n", rtc.getI2CError());
+            return false;
+        }
+        Serial.printf("RTC set in %u us\n", rtc.getAdjustMicros());
+        // An explicit set may move time backwards, so re-anchor without the monotonic clamp
+        _lastUnix = 0;
+        syncClock();
         return true;
     }
     return false;
 }
 
-String MCP7940Scheduler::getCurrentTimestamp() {
-    DateTime now = rtc.now();
-    char buffer[20];
-    snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d %02d:%02d:%02d",
-             now.year(), now.month(), now.day(),
-             now.hour(), now.minute(), now.second());
-    return String(buffer);
+// Fields a running MCP7940 can hold, a failed or garbled read is outside them
+static bool plausibleTime(const DateTime& time) {
+    return time.month() >= 1 && time.month() <= 12 && time.day() >= 1 && time.day() <= 31 &&
+           time.hour() <= 23 && time.minute() <= 59 && time.second() <= 59;
+}
+
+DateTime MCP7940Scheduler::syncClock() {
+    DateTime rtcNow = rtc.now();
+    if (rtc.getI2CError() != 0 || !plausibleTime(rtcNow)) {
+        // Keep running on the previous anchor, the next call tries the RTC again
+        Serial.printf("RTC read failed, I2C error %u\n", rtc.getI2CError());
+        if (!_clockValid) {
+            return DateTime(0);
+        }
+        return DateTime(_anchorUnix + (millis() - _anchorMillis) / 1000);
+    }
+    _anchorUnix = rtcNow.unixtime();
+    _anchorMillis = millis();
+    _clockValid = true;
+    if (_anchorUnix > _lastUnix) {
+        _lastUnix = _anchorUnix;
+    }
+    return rtcNow;
+}
+
+DateTime MCP7940Scheduler::now() {
+    if (!_clockValid || millis() - _anchorMillis >= _resyncInterval) {
+        syncClock();
+    }
+    uint32_t seconds = _anchorUnix + (millis() - _anchorMillis) / 1000;
+    // If the RTC was behind the millis() estimate at the last resync, hold time until it catches up
+    if (seconds < _lastUnix) {
+        seconds = _lastUnix;
+    }
+    _lastUnix = seconds;
+    return DateTime(seconds);
+}
+
+const char* MCP7940Scheduler::getCurrentTimestamp() {
+    DateTime current = now();
+    if (current.unixtime() != _timestampUnix || _timestamp.size() == 0) {
+        _timestamp.clear();
+        _timestamp.appendTimestamp(current);
+        _timestampUnix = current.unixtime();
+    }
+    return _timestamp.c_str();
+}
+
+void MCP7940Scheduler::setClockResyncInterval(uint32_t intervalMs) {
+    _resyncInterval = intervalMs;
 }
 
 
 bool MCP7940Scheduler::setSchedules(const WateringSchedules& schedules) {
-    return rtc.writeRAM(0, schedules);
+    for (int i = 0; i < MAX_SCHEDULES; ++i) {
+        if (!validSchedule(schedules.items[i])) {
+            return false;
+        }
+    }
+    for (int i = 0; i < MAX_SCHEDULES; ++i) {
+        _records[i] = packSchedule(schedules.items[i]);
+    }
+    if (!writeRecords()) {
+        // The backing store may now hold a partial write, reload it on the next access
+        _schedulesLoaded = false;
+        _timelineValid = false;
+        return false;
+    }
+    updateSlotCrcs();
+    _schedulesLoaded = true;
+    compileTimeline(_records);
+    return true;
 }
 
 bool MCP7940Scheduler::getSchedules(WateringSchedules& schedules) {
-    return rtc.readRAM(0, schedules) > 0;
+    if (!schedulesIntact() && !loadSchedules()) {
+        return false;
+    }
+    for (int i = 0; i < MAX_SCHEDULES; ++i) {
+        schedules.items[i] = unpackSchedule(_records[i]);
+    }
+    return true;
+}
+
+bool MCP7940Scheduler::setSchedule(uint16_t index, const ScheduleItem& item) {
+    if (index >= MAX_SCHEDULES || !validSchedule(item)) {
+        return false;
+    }
+    // The other slots must be known before the timeline can be rebuilt
+    if (!schedulesIntact() && !loadSchedules()) {
+        return false;
+    }
+    _records[index] = packSchedule(item);
+    if (!writeRecord(index)) {
+        _schedulesLoaded = false;
+        _timelineValid = false;
+        return false;
+    }
+    _slotCrc[index] = slotCrc(_records[index]);
+    compileTimeline(_records);
+    return true;
+}
+
+bool MCP7940Scheduler::getSchedule(uint16_t index, ScheduleItem& item) {
+    if (index >= MAX_SCHEDULES) {
+        return false;
+    }
+    if (!schedulesIntact() && !loadSchedules()) {
+        return false;
+    }
+    item = unpackSchedule(_records[index]);
+    return true;
+}
+
+bool MCP7940Scheduler::schedulesIntact() const {
+    if (!_schedulesLoaded) {
+        return false;
+    }
+    for (int i = 0; i < MAX_SCHEDULES; ++i) {
+        if (slotCrc(_records[i]) != _slotCrc[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void MCP7940Scheduler::updateSlotCrcs() {
+    for (int i = 0; i < MAX_SCHEDULES; ++i) {
+        _slotCrc[i] = slotCrc(_records[i]);
+    }
+}
+
+bool MCP7940Scheduler::writeSramBank() {
+    ScheduleBank bank;
+    memcpy(bank.records, _records, sizeof(bank.records));
+    sealBlock(bank, _generation + 1);
+
+    uint8_t target = _activeBank ^ 1;
+    if (!rtc.writeRAM(target * sizeof(ScheduleBank), bank)) {
+        return false; // The active bank is untouched
+    }
+    _activeBank = target;
+    _generation = bank.header.generation;
+    return true;
+}
+
+bool MCP7940Scheduler::writeOverflow() {
+    // Every commit erases and rewrites the flash sector, so a burst of edits shares one
+    uint32_t nowMillis = millis();
+    if (!_overflowPending) {
+        _overflowPendingSince = nowMillis;
+    }
+    _overflowChangedAt = nowMillis;
+    _overflowPending = true;
+    return true;
+}
+
+bool MCP7940Scheduler::commitOverflow() {
+    ScheduleOverflow overflow;
+    memcpy(overflow.records, _records + SRAM_SCHEDULES, sizeof(overflow.records));
+    sealBlock(overflow, 0);
+
+    // Only bytes that differ dirty the buffer, an unchanged block needs no commit at all
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&overflow);
+    EEPROM.begin(EEPROM_SIZE);
+    for (size_t i = 0; i < sizeof(overflow); ++i) {
+        if (EEPROM.read(SCHEDULE_EEPROM_ADDR + i) != bytes[i]) {
+            EEPROM.write(SCHEDULE_EEPROM_ADDR + i, bytes[i]);
+        }
+    }
+    bool committed = EEPROM.commit();
+    EEPROM.end();
+    if (committed) {
+        _overflowPending = false;
+    }
+    return committed;
+}
+
+bool MCP7940Scheduler::flushSchedules(bool force) {
+    if (!_overflowPending) {
+        return true;
+    }
+    uint32_t nowMillis = millis();
+    if (!force && nowMillis - _overflowChangedAt < SCHEDULE_COMMIT_QUIET_MS &&
+        nowMillis - _overflowPendingSince < SCHEDULE_COMMIT_MAX_MS) {
+        return true;
+    }
+    if (!commitOverflow()) {
+        Serial.println("Failed to commit schedules to EEPROM.");
+        _overflowChangedAt = nowMillis; // Retry after another quiet period
+        return false;
+    }
+    return true;
+}
+
+bool MCP7940Scheduler::writeRecord(uint16_t index) {
+    return index < SRAM_SCHEDULES ? writeSramBank() : writeOverflow();
+}
+
+bool MCP7940Scheduler::writeRecords() {
+    bool written = writeSramBank();
+    return writeOverflow() && written;
+}
+
+bool MCP7940Scheduler::loadSchedules() {
+    // Uncommitted records would be lost to the stale EEPROM copy. A RAM copy that fails its CRCs
+    // is not committed though, its pending records are dropped in favour of the EEPROM
+    if (schedulesIntact()) {
+        flushSchedules(true);
+    } else {
+        _overflowPending = false;
+    }
+
+    // The whole RTC RAM in one read, both banks are validated from it
+    ScheduleSram sram;
+    if (rtc.readRAM(0, sram) != sizeof(sram)) {
+        _schedulesLoaded = false;
+        return false;
+    }
+
+    uint32_t stored[MAX_SCHEDULES];
+    bool rewriteSram = false;
+    bool rewriteOverflow = false;
+    bool migrating = false;
+    int8_t bank = newestBank(sram);
+    if (bank >= 0) {
+        memcpy(stored, sram.banks[bank].records, sizeof(sram.banks[bank].records));
+        _activeBank = bank;
+        _generation = sram.banks[bank].header.generation;
+    } else if (migrateLegacy(sram, stored)) {
+        Serial.println("Migrating schedules from the legacy RTC RAM layout.");
+        rewriteSram = true;
+        rewriteOverflow = true;
+        migrating = true;
+    } else if (sramBlank(sram)) {
+        // A new or cleared RTC: nothing to migrate or report, just lay down an empty bank
+        memset(stored, 0, sizeof(stored));
+        rewriteSram = true;
+    } else {
+        Serial.println("No valid schedule bank in RTC RAM, starting blank.");
+        memset(stored, 0, sizeof(stored));
+        rewriteSram = true;
+    }
+
+    if (!rewriteOverflow) {
+        ScheduleOverflow overflow;
+        EEPROM.begin(EEPROM_SIZE);
+        EEPROM.get(SCHEDULE_EEPROM_ADDR, overflow);
+        EEPROM.end();
+        if (blockValid(overflow)) {
+            memcpy(stored + SRAM_SCHEDULES, overflow.records, sizeof(overflow.records));
+        } else {
+            memset(stored + SRAM_SCHEDULES, 0, sizeof(overflow.records));
+            rewriteOverflow = true;
+        }
+    }
+
+    // Reset slots holding values no valid schedule can have
+    for (int i = 0; i < MAX_SCHEDULES; ++i) {
+        if (!validRecord(stored[i])) {
+            stored[i] = 0;
+            if (i < SRAM_SCHEDULES) {
+                rewriteSram = true;
+            } else {
+                rewriteOverflow = true;
+            }
+        }
+    }
+
+    memcpy(_records, stored, sizeof(_records));
+    updateSlotCrcs();
+    _schedulesLoaded = true;
+    compileTimeline(_records);
+
+    if (rewriteOverflow) {
+        writeOverflow();
+        // The legacy image is the only copy of the overflow slots until the EEPROM holds them, so
+        // it stays in place to be migrated again on the next boot if the commit fails
+        if (migrating && !flushSchedules(true)) {
+            rewriteSram = false;
+        }
+    }
+    if (rewriteSram) {
+        writeSramBank();
+    }
+    return true;
+}
+
+bool MCP7940Scheduler::verifySchedules() {
+    // A damaged RAM copy is replaced by what the backing store holds
+    if (!schedulesIntact()) {
+        Serial.println("Schedule cache invalid, reloading from RTC RAM.");
+        return loadSchedules();
+    }
+
+    if (rtc.getPowerFail()) {
+        Serial.println("RTC reported a power failure, checking schedules.");
+        rtc.clearPowerFail();
+    }
+
+    ScheduleSram sram;
+    if (rtc.readRAM(0, sram) != sizeof(sram)) {
+        return false;
+    }
+    ScheduleOverflow overflow;
+    EEPROM.begin(EEPROM_SIZE);
+    EEPROM.get(SCHEDULE_EEPROM_ADDR, overflow);
+    EEPROM.end();
+
+    // The RAM copy is known good, so a differing store is the side that lost data
+    bool verified = true;
+    const ScheduleBank& active = sram.banks[_activeBank];
+    if (!blockValid(active) || active.header.generation != _generation ||
+        memcmp(active.records, _records, sizeof(active.records)) != 0) {
+        Serial.println("RTC RAM schedules differ from cache, rewriting.");
+        verified = writeSramBank();
+    }
+    // Pending records are expected to differ until flushSchedules() commits them
+    if (!_overflowPending && (!blockValid(overflow) ||
+        memcmp(overflow.records, _records + SRAM_SCHEDULES, sizeof(overflow.records)) != 0)) {
+        Serial.println("EEPROM schedules differ from cache, rewriting.");
+        verified = writeOverflow() && verified;
+    }
+    return verified;
 }
 
 bool MCP7940Scheduler::setManualStopTime(uint16_t duration_sec) {
@@ -69,15 +532,19 @@ bool MCP7940Scheduler::setManualStopTime(uint16_t duration_sec) {
     
     // CRITICAL FIX: Clear any pre-existing alarm flag before setting a new one.
     // This prevents a race condition where a stale flag from a previous (or empty)
-    // schedule could cause an immediate trigger.
-    rtc.setAlarmState(ALARM::OFFTRIGGER, false);
-    rtc.clearAlarm(ALARM::OFFTRIGGER);
-    
-    DateTime now = rtc.now();
+    // schedule could cause an immediate trigger. The transaction keeps the alarm
+    // disabled while the new match value is loaded.
+    DateTime now = syncClock();
+    if (!_clockValid) {
+        Serial.println("No valid RTC time, manual stop time not set.");
+        return false;
+    }
     DateTime offAlarmTime = now + TimeSpan(duration_sec);
 
-    
-    if (!rtc.setAlarm(ALARM::OFFTRIGGER, ALARM_TYPE, offAlarmTime, true)) {
+    MCP7940_Transaction alarm(rtc);
+    alarm.clearAlarm(ALARM::OFFTRIGGER);
+    alarm.setAlarm(ALARM::OFFTRIGGER, ALARM_TYPE, offAlarmTime, true);
+    if (!alarm.commit()) {
         Serial.println("Failed to set manual OFFTRIGGER alarm.");
         return false;
     }
@@ -86,59 +553,62 @@ bool MCP7940Scheduler::setManualStopTime(uint16_t duration_sec) {
 }
 
 bool MCP7940Scheduler::setNextAlarm() {
-    DateTime now = rtc.now();
-    WateringSchedules allSchedules;
-    if (!getSchedules(allSchedules)) {
+#ifdef SCHEDULER_DEBUG
+    uint32_t i2cStart = rtc.getI2CTransactions();
+#endif
+    DateTime now = syncClock();
+    if (!_clockValid) {
+        Serial.println("No valid RTC time, alarms left unchanged.");
+        return false;
+    }
+    if (!_timelineValid && !loadSchedules()) {
         Serial.println("Could not read schedules from RTC RAM. Initializing blank schedule set.");
-        memset(&allSchedules, 0, sizeof(allSchedules));
+        static const uint32_t blank[MAX_SCHEDULES] = {};
+        compileTimeline(blank);
+        _timelineValid = false; // Try the RTC again on the next call
     }
 
     DateTime earliestNextAlarm(0);
-    uint16_t durationForNextAlarm = 0;
+    uint32_t durationForNextAlarm = 0;
 
-    // Iterate through all possible schedule slots
-    for (int i = 0; i < MAX_SCHEDULES; ++i) {
-        const auto& schedule = allSchedules.items[i];
-        if (!schedule.enabled || schedule.daysOfWeek == 0) {
-            continue; // Skip disabled or empty schedules
-        }
-
-        // Check the next 7 days to find the earliest future occurrence for this schedule
-        for (int dayOffset = 0; dayOffset < 7; ++dayOffset) {
-            DateTime checkDate = now + TimeSpan(dayOffset, 0, 0, 0);
-            
-            // The library returns 1 for Monday, ..., 7 for Sunday.
-            // Our bitmask needs 0 for Sunday, 1 for Monday, etc.
-            // The `dayOfWeek % 7` trick correctly maps 7 (Sun) -> 0, 1 (Mon) -> 1, etc.
-            uint8_t dayOfWeek = checkDate.dayOfTheWeek();
-            uint8_t bitIndex = dayOfWeek % 7;
-
-            // Check if the schedule is set to run on this day of the week
-            if ((schedule.daysOfWeek >> bitIndex) & 1) {
-                DateTime potentialAlarmTime(checkDate.year(), checkDate.month(), checkDate.day(),
-                                            schedule.hour, schedule.minute, 0);
-                
-                // If this potential time is in the future...
-                if (potentialAlarmTime.unixtime() > now.unixtime()) {
-                    // ...and it's the first one we've found, or it's earlier than the one we already have...
-                    if (earliestNextAlarm.unixtime() == 0 || potentialAlarmTime.unixtime() < earliestNextAlarm.unixtime()) {
-                        // ...then this is our new best candidate for the next alarm.
-                        earliestNextAlarm = potentialAlarmTime;
-                        durationForNextAlarm = schedule.duration_sec;
-                    }
-                    // IMPORTANT: We found the soonest possible time for this schedule,
-                    // so we can stop checking future days for this specific schedule and move to the next.
-                    break; 
-                }
+    if (_timelineLength > 0) {
+        // The library returns 1 for Monday, ..., 7 for Sunday, the timeline starts on Sunday.
+        uint32_t nowSecond = (now.dayOfTheWeek() % 7) * 86400UL + now.hour() * 3600UL +
+                             now.minute() * 60UL + now.second();
+        uint16_t nowMinute = nowSecond / 60;
+
+        // First run starting strictly after now, or the first run of next week. Continued runs
+        // are covered by the run ahead of them and never start the pump themselves.
+        TimelineEntry* end = _timeline + _timelineLength;
+        TimelineEntry* next = std::upper_bound(_timeline, end, nowMinute,
+            [](uint16_t minute, const TimelineEntry& entry) { return minute < entry.startMinute(); });
+        while (next != end && next->continued()) {
+            ++next;
+        }
+        uint32_t startSecond = 0;
+        if (next == end) {
+            next = _timeline;
+            while (next->continued()) {
+                ++next;
             }
+            startSecond = SECONDS_PER_WEEK;
         }
+        startSecond += next->startMinute() * 60UL;
+
+        earliestNextAlarm = now + TimeSpan(startSecond - nowSecond);
+        durationForNextAlarm = runSeconds(next);
+#ifdef SCHEDULER_DEBUG
+        Serial.printf("Next run from schedule slot %d\n", next->slot());
+#endif
     }
 
-    // Clear any previous hardware alarms before setting new ones
-    rtc.clearAlarm(ALARM::ONTRIGGER);
-    rtc.clearAlarm(ALARM::OFFTRIGGER);
-    rtc.setAlarmState(ALARM::ONTRIGGER, false);
-    rtc.setAlarmState(ALARM::OFFTRIGGER, false);
+    // Clear any previous hardware alarms and program the new ones in one batch.
+    // On a failed write the transaction restores the previous alarm registers.
+    MCP7940_Transaction alarms(rtc);
+    alarms.clearAlarm(ALARM::ONTRIGGER);
+    alarms.clearAlarm(ALARM::OFFTRIGGER);
+    alarms.setAlarmState(ALARM::ONTRIGGER, false);
+    alarms.setAlarmState(ALARM::OFFTRIGGER, false);
 
     _nextDueAlarm = earliestNextAlarm; // Store the final result
 
@@ -147,36 +617,142 @@ bool MCP7940Scheduler::setNextAlarm() {
                       earliestNextAlarm.year(), earliestNextAlarm.month(), earliestNextAlarm.day(),
                       earliestNextAlarm.hour(), earliestNextAlarm.minute(), earliestNextAlarm.second());
 
-        // Set the hardware alarm to turn the pump ON
-        if (!rtc.setAlarm(ALARM::ONTRIGGER, ALARM_TYPE, earliestNextAlarm, true)) {
-            Serial.println("Failed to set ONTRIGGER alarm.");
-            return false;
-        }
-        
-        // Calculate the stop time and set the hardware alarm to turn the pump OFF
+        // Hardware alarm to turn the pump ON, and OFF after the scheduled duration
         DateTime offAlarmTime = earliestNextAlarm + TimeSpan(durationForNextAlarm);
-        if (!rtc.setAlarm(ALARM::OFFTRIGGER, ALARM_TYPE, offAlarmTime, true)) {
-            Serial.println("Failed to set OFFTRIGGER alarm.");
-            rtc.setAlarmState(ALARM::ONTRIGGER, false); // Rollback the ON alarm
-            return false;
-        }
+        alarms.setAlarm(ALARM::ONTRIGGER, ALARM_TYPE, earliestNextAlarm, true);
+        alarms.setAlarm(ALARM::OFFTRIGGER, ALARM_TYPE, offAlarmTime, true);
+    }
+
+    if (!alarms.commit()) {
+        Serial.println("Failed to program alarms, previous alarm registers restored.");
+        return false;
+    }
+
+    if (earliestNextAlarm.unixtime() > 0) {
+#ifdef SCHEDULER_DEBUG
+        Serial.printf("Alarms programmed with %u I2C transfers\n", rtc.getI2CTransactions() - i2cStart);
+#endif
         return true;
-    } 
-    
+    }
+
     Serial.println("No future alarms to set.");
     return false;
 }
 
+void MCP7940Scheduler::compileTimeline(const uint32_t (&records)[MAX_SCHEDULES]) {
+    // Expand every enabled schedule into one run per selected weekday
+    _timelineLength = 0;
+    for (int i = 0; i < MAX_SCHEDULES; ++i) {
+        const ScheduleItem schedule = unpackSchedule(records[i]);
+        if (!schedule.enabled || schedule.daysOfWeek == 0 || !validRecord(records[i])) {
+            continue; // Skip disabled, empty or corrupt schedules
+        }
+        for (uint8_t day = 0; day < 7; ++day) {
+            if ((schedule.daysOfWeek >> day) & 1) {
+                _timeline[_timelineLength++] =
+                    packTimelineEntry(day * 1440 + schedule.hour * 60 + schedule.minute, i);
+            }
+        }
+    }
+
+    std::sort(_timeline, _timeline + _timelineLength, [](const TimelineEntry& a, const TimelineEntry& b) {
+        return a.startMinute() < b.startMinute();
+    });
+    if (_timelineLength == 0) {
+        _timelineValid = true;
+        return;
+    }
+
+    // Runs that start before (or exactly when) the previous one ends are marked continued and the
+    // earlier run is stretched over them, otherwise the later run would be skipped once the
+    // earlier one stops the pump.
+    uint16_t lastRun = 0;
+    uint32_t runEnd = 0;
+    for (uint16_t i = 0; i < _timelineLength; ++i) {
+        uint32_t start = _timeline[i].startMinute() * 60UL;
+        uint32_t end = start + unpackSchedule(records[_timeline[i].slot()]).duration_sec;
+        if (i > 0 && start <= runEnd) {
+            _timeline[i].setContinued();
+            runEnd = std::max(runEnd, end);
+        } else {
+            lastRun = i;
+            runEnd = end;
+        }
+    }
+
+    // A run crossing Saturday midnight can swallow the first runs of the week
+    for (uint16_t i = 0; i < lastRun; ++i) {
+        uint32_t start = _timeline[i].startMinute() * 60UL + SECONDS_PER_WEEK;
+        if (start > runEnd) {
+            break;
+        }
+        _timeline[i].setContinued();
+        runEnd = std::max(runEnd, start + unpackSchedule(records[_timeline[i].slot()]).duration_sec);
+    }
+
+    _timelineValid = true;
+}
+
+uint32_t MCP7940Scheduler::runSeconds(const TimelineEntry* run) const {
+    uint32_t start = run->startMinute() * 60UL;
+    uint32_t end = start + unpackSchedule(_records[run->slot()]).duration_sec;
+    uint32_t week = 0;
+    const TimelineEntry* entry = run;
+    for (uint16_t n = 1; n < _timelineLength; ++n) {
+        if (++entry == _timeline + _timelineLength) {
+            entry = _timeline;
+            week = SECONDS_PER_WEEK;
+        }
+        if (!entry->continued()) {
+            break;
+        }
+        uint32_t entryEnd = entry->startMinute() * 60UL + week + unpackSchedule(_records[entry->slot()]).duration_sec;
+        end = std::max(end, entryEnd);
+    }
+    return end - start;
+}
+
 bool MCP7940Scheduler::alarmTriggered(ALARM alarm) {
     return rtc.isAlarm(static_cast<uint8_t>(alarm));
 }
 
+AlarmStatus MCP7940Scheduler::getAlarmStatus() {
+    uint8_t status = rtc.getAlarmStatus();
+    AlarmStatus alarms;
+    alarms.triggered[ALARM::ONTRIGGER] = bitRead(status, MCP7940_ALM0IF_STATUS);
+    alarms.triggered[ALARM::OFFTRIGGER] = bitRead(status, MCP7940_ALM1IF_STATUS);
+    alarms.enabled[ALARM::ONTRIGGER] = bitRead(status, MCP7940_ALM0EN_STATUS);
+    alarms.enabled[ALARM::OFFTRIGGER] = bitRead(status, MCP7940_ALM1EN_STATUS);
+    // Keep timestamps of alarm driven events on the RTC's second. Polled flags stay set until
+    // the next alarm is programmed, so only a flag that was clear last time resyncs.
+    uint8_t flags = alarms.triggered[ALARM::ONTRIGGER] | alarms.triggered[ALARM::OFFTRIGGER] << 1;
+    if (flags & ~_alarmFlags) {
+        syncClock();
+    }
+    _alarmFlags = flags;
+    return alarms;
+}
+
+void MCP7940Scheduler::clearAlarm(ALARM alarm) {
+    rtc.clearAlarm(static_cast<uint8_t>(alarm));
+}
+
+void MCP7940Scheduler::setAlarmPolarity(bool activeHigh) {
+    // With both alarms enabled ALMPOL=1 gives MFP = ALM0IF | ALM1IF, so either alarm
+    // produces a rising edge. ALMPOL lives in ALM0WKDAY and setAlarm() preserves it.
+    rtc.setAlarmPolarity(activeHigh);
+}
+
 void MCP7940Scheduler::getAlarms(DateTime &onAlarm, DateTime &offAlarm) {
     uint8_t alarmType;
     onAlarm = rtc.getAlarm(0, alarmType);
     offAlarm = rtc.getAlarm(1, alarmType);
 }
 
+uint32_t MCP7940Scheduler::getI2CTransactions() const {
+    return rtc.getI2CTransactions();
+}
+
 DateTime MCP7940Scheduler::getNextDueAlarm() const {
     return _nextDueAlarm;
 }
\ No newline at end of file
@@ -3,9 +3,19 @@
 
 #include <Arduino.h>
 #include "MCP7940.h"
+#include "MessageBuilder.h"
 
 #define NTP_SERVER "pool.ntp.org"
-#define MAX_SCHEDULES 10
+#define TIMESTAMP_SIZE 20  // "YYYY-MM-DD HH:MM:SS" plus terminator
+#define DEFAULT_TIMEZONE_MINUTES 330  // UTC+5:30
+#define CLOCK_RESYNC_INTERVAL 3600000UL  // Default ms between software clock resyncs with the RTC
+#define MAX_SCHEDULES 32
+#define SRAM_SCHEDULES 7            // Packed records per RTC RAM bank, two 32-byte banks fill the 64 bytes
+#define SCHEDULE_EEPROM_ADDR 0x100  // The remaining records overflow into EEPROM from here
+#define EEPROM_SIZE 512             // EEPROM.begin() size for every user, a commit only keeps this many bytes
+#define SCHEDULE_COMMIT_QUIET_MS 10000UL  // Commit overflow edits once they have been quiet this long
+#define SCHEDULE_COMMIT_MAX_MS 60000UL    // and never hold one back longer than this
+// #define SCHEDULER_DEBUG          // Log the I2C cost and source slot of every alarm update
 
 // Bitmask for days of the week for schedule repetition
 #define DOW_SUNDAY    (1 << 0)
@@ -26,17 +36,76 @@ struct ScheduleItem {
     bool enabled;           // True if this schedule is active
 };
 
-// A structure to hold all watering schedules, designed to be stored in RTC RAM
+// A structure to hold all watering schedules
 struct WateringSchedules {
     ScheduleItem items[MAX_SCHEDULES];
 };
 
+// Schedules are stored as one packed 32-bit record each:
+//   bits  0-10  start minute of the day (0-1439)
+//   bits 11-17  days of week bitmask
+//   bit  18     enabled
+//   bit  19     duration unit, 0 = seconds, 1 = minutes
+//   bits 20-31  duration (0-4095), so runs over 4095 s are kept to the nearest minute
+#define SCHEDULE_DURATION_MAX 4095
+
+constexpr uint32_t packSchedule(const ScheduleItem& item) {
+    return (uint32_t)(item.hour * 60 + item.minute) |
+           (uint32_t)(item.daysOfWeek & DOW_EVERYDAY) << 11 |
+           (uint32_t)item.enabled << 18 |
+           (item.duration_sec <= SCHEDULE_DURATION_MAX
+                ? (uint32_t)item.duration_sec << 20
+                : 1UL << 19 | (uint32_t)((item.duration_sec + 30) / 60) << 20);
+}
+
+constexpr ScheduleItem unpackSchedule(uint32_t record) {
+    return ScheduleItem{
+        (uint8_t)((record & 0x7FF) / 60),
+        (uint8_t)((record & 0x7FF) % 60),
+        (uint16_t)((record >> 19) & 1 ? (record >> 20) * 60 : record >> 20),
+        (uint8_t)((record >> 11) & DOW_EVERYDAY),
+        (bool)((record >> 18) & 1)};
+}
+
+// A record decodes to a valid schedule: start within the day and a duration that fits 16 bits
+constexpr bool validRecord(uint32_t record) {
+    return (record & 0x7FF) < 1440 && (!((record >> 19) & 1) || (record >> 20) <= 65535 / 60);
+}
+
+#define MINUTES_PER_WEEK 10080UL
+#define SECONDS_PER_WEEK 604800UL
+
+// One watering run in the compiled weekly timeline, 4 bytes:
+//   start bits  0-13  minute of the week the run starts (0-10079), 0 = Sunday 00:00
+//   start bit   15    continued, the run starts before the one ahead of it ends and only extends it
+//   slot              schedule slot the run was compiled from, its record holds the duration
+struct TimelineEntry {
+    uint16_t start;
+    uint16_t slotIndex;
+
+    uint16_t startMinute() const { return start & 0x3FFF; }
+    uint16_t slot() const { return slotIndex; }
+    bool continued() const { return start >> 15; }
+    void setContinued() { start |= 0x8000; }
+};
+static_assert(MAX_SCHEDULES * 7 <= UINT16_MAX, "the timeline is indexed with 16 bits");
+
+inline TimelineEntry packTimelineEntry(uint16_t startMinute, uint16_t slot) {
+    return {(uint16_t)(startMinute & 0x3FFF), slot};
+}
+
 // Enumeration for Alarm State
 enum ALARM {
     ONTRIGGER,
     OFFTRIGGER
 };
 
+// Snapshot of both hardware alarms from a single RTC read, indexed by ALARM
+struct AlarmStatus {
+    bool triggered[2];
+    bool enabled[2];
+};
+
 class MCP7940Scheduler {
 public:
     MCP7940Scheduler();
@@ -44,24 +113,45 @@ public:
     // Initialize the RTC and set initial time if available from NTP
     void begin();
 
-    // Set time zone
+    // Set time zone, kept as signed minutes so the NTP path needs no float math
+    void setTimeZoneMinutes(int16_t offsetMinutes);
     void setTimeZone(float timezoneOffsetHours);
 
     // Get the current time zone
+    int16_t getTimeZoneMinutes() const;
     float getTimeZone();
 
     // Update time from NTP (called at startup or once a week)
     bool updateTimeFromNTP();
 
-    // Get the current date and time as a string
-    String getCurrentTimestamp();
+    // Current date and time from the software clock, only reads the RTC when a resync is due
+    DateTime now();
+
+    // Current date and time as "YYYY-MM-DD HH:MM:SS", formatted at most once per second
+    const char* getCurrentTimestamp();
+
+    // How often the software clock is re-anchored to the RTC
+    void setClockResyncInterval(uint32_t intervalMs);
 
     // Set a watering schedule
     bool setSchedules(const WateringSchedules& schedules);
 
-    // Get a watering schedule
+    // Get a watering schedule (served from the RAM copy, no I2C)
     bool getSchedules(WateringSchedules& schedules);
 
+    // Set a single schedule slot, only that slot is written to RTC RAM
+    bool setSchedule(uint16_t index, const ScheduleItem& item);
+
+    // Get a single schedule slot (served from the RAM copy, no I2C)
+    bool getSchedule(uint16_t index, ScheduleItem& item);
+
+    // Compare the RAM copy with RTC RAM and repair whichever side is damaged
+    bool verifySchedules();
+
+    // Commit pending EEPROM overflow records once edits have settled, or now when forced.
+    // Call from loop(), and forced before a restart.
+    bool flushSchedules(bool force = false);
+
     // Set next watering schedule
     bool setNextAlarm();
 
@@ -72,17 +162,88 @@ public:
     // Check if a specific alarm is triggered
     bool alarmTriggered(ALARM alarm);
 
+    // Read which alarms fired and which are enabled in one I2C transaction
+    AlarmStatus getAlarmStatus();
+
+    // Clear the flag of a triggered alarm
+    void clearAlarm(ALARM alarm);
+
+    // Drive the MFP pin high while any enabled alarm has fired (for interrupt delivery)
+    void setAlarmPolarity(bool activeHigh);
+
     // Get the current alarms (returns both Alarm 0 and Alarm 1)
     void getAlarms(DateTime &alarm0, DateTime &alarm1);
 
+    // I2C transfers issued to the RTC so far, for measuring the bus cost of a call
+    uint32_t getI2CTransactions() const;
+
     
 
 
 private:
   MCP7940_Class rtc;
   DateTime _nextDueAlarm; // NEW: Stores the time of the next due alarm
-  float timezoneOffset;     // Time zone offset in hours
+  int16_t timezoneOffset;   // Time zone offset in minutes
   uint8_t ALARM_TYPE = 7;
+
+  // Software clock: the RTC time read at _anchorMillis, advanced by millis()
+  uint32_t _anchorUnix;
+  uint32_t _anchorMillis;
+  uint32_t _lastUnix;        // Latest time handed out, the clock never goes back past it
+  uint32_t _resyncInterval;
+  bool _clockValid;
+  uint8_t _alarmFlags;       // Alarm flags seen by the last getAlarmStatus(), it resyncs on new ones
+  MessageBuilder<TIMESTAMP_SIZE> _timestamp;
+  uint32_t _timestampUnix;   // Second that _timestamp was formatted for
+
+  // Re-anchor the software clock with one RTC read and return the time read. A failed read keeps
+  // the previous anchor and returns the software time, or DateTime(0) before the first good read.
+  DateTime syncClock();
+
+  // Validated write-through copy of the packed records held in RTC RAM and EEPROM
+  uint32_t _records[MAX_SCHEDULES];
+  uint8_t _slotCrc[MAX_SCHEDULES]; // CRC-8 per slot, so a slot edit only rehashes that slot
+  bool _schedulesLoaded;
+  uint8_t _activeBank;             // RTC RAM bank holding the current records, writes go to the other one
+  uint8_t _generation;             // Generation of the active bank
+
+  // Read the schedules from RTC RAM and EEPROM once, repairing corrupt slots
+  bool loadSchedules();
+
+  // Write the RTC RAM records into the inactive bank and make it the active one
+  bool writeSramBank();
+
+  // Overflow records changed in RAM but not yet committed to EEPROM
+  bool _overflowPending;
+  uint32_t _overflowPendingSince; // millis() of the first uncommitted edit
+  uint32_t _overflowChangedAt;    // millis() of the latest one
+
+  // Queue the overflow records for the next flushSchedules() commit
+  bool writeOverflow();
+
+  // Write the overflow bytes that differ from EEPROM and commit them
+  bool commitOverflow();
+
+  // Write one record, or all of them, from the RAM copy to its backing store
+  bool writeRecord(uint16_t index);
+  bool writeRecords();
+
+  // True if the RAM copy is loaded and every slot matches its CRC
+  bool schedulesIntact() const;
+
+  // Recompute the CRC of every slot after the whole set changed
+  void updateSlotCrcs();
+
+  // Enabled schedules compiled into runs sorted by minute of the week
+  TimelineEntry _timeline[MAX_SCHEDULES * 7];
+  uint16_t _timelineLength;
+  bool _timelineValid;
+
+  // Rebuild the timeline, called whenever the schedules change
+  void compileTimeline(const uint32_t (&records)[MAX_SCHEDULES]);
+
+  // Seconds from the start of a run to the end of the last run continuing it
+  uint32_t runSeconds(const TimelineEntry* run) const;
 };
 
 #endif // MCP7940_SCHEDULER_H
\ No newline at end of file
@@ -0,0 +1,107 @@
+#ifndef MESSAGE_BUILDER_H
+#define MESSAGE_BUILDER_H
+
+#include <Arduino.h>
+#include "MCP7940.h"
+
+// Builds a message in a fixed-size buffer owned by the builder, so publishing never touches the heap.
+// Appends that do not fit are truncated and flagged, the buffer is always NUL terminated.
+template <size_t N>
+class MessageBuilder {
+public:
+    MessageBuilder() { clear(); }
+
+    void clear() {
+        length = 0;
+        overflow = false;
+        buffer[0] = '\0';
+    }
+
+    MessageBuilder& append(char c) {
+        if (length + 1 < N) {
+            buffer[length++] = c;
+            buffer[length] = '\0';
+        } else {
+            overflow = true;
+        }
+        return *this;
+    }
+
+    MessageBuilder& append(const char* text) {
+        while (*text) append(*text++);
+        return *this;
+    }
+
+    MessageBuilder& appendUInt(unsigned long value, uint8_t width = 0) {
+        char digits[10];
+        uint8_t count = 0;
+        do {
+            digits[count++] = '0' + value % 10;
+            value /= 10;
+        } while (value > 0);
+        while (width > count) {
+            append('0');  // Zero padding for fixed-width fields
+            --width;
+        }
+        while (count > 0) append(digits[--count]);
+        return *this;
+    }
+
+    MessageBuilder& appendInt(long value) {
+        if (value < 0) {
+            append('-');
+            return appendUInt(0UL - (unsigned long)value);
+        }
+        return appendUInt(value);
+    }
+
+    // Fixed point value with the given number of implied decimals, 12345 with 2 gives "123.45"
+    MessageBuilder& appendFixed(long value, uint8_t decimals) {
+        unsigned long magnitude = value < 0 ? 0UL - (unsigned long)value : value;
+        if (value < 0) append('-');
+        unsigned long scale = 1;
+        for (uint8_t i = 0; i < decimals; ++i) scale *= 10;
+        appendUInt(magnitude / scale);
+        if (decimals > 0) {
+            append('.');
+            appendUInt(magnitude % scale, decimals);
+        }
+        return *this;
+    }
+
+    // Same output as String(float, decimals) for values that fit an unsigned long
+    MessageBuilder& appendFloat(float value, uint8_t decimals = 2) {
+        if (value != value) return append("nan");  // NaN
+        if (value < 0) {
+            append('-');
+            value = -value;
+        }
+        unsigned long scale = 1;
+        for (uint8_t i = 0; i < decimals; ++i) scale *= 10;
+        unsigned long scaled = (unsigned long)(value * scale + 0.5f);
+        appendUInt(scaled / scale);
+        if (decimals > 0) {
+            append('.');
+            appendUInt(scaled % scale, decimals);
+        }
+        return *this;
+    }
+
+    // "YYYY-MM-DD HH:MM:SS"
+    MessageBuilder& appendTimestamp(const DateTime& time) {
+        appendUInt(time.year(), 4).append('-').appendUInt(time.month(), 2).append('-').appendUInt(time.day(), 2);
+        append(' ');
+        return appendUInt(time.hour(), 2).append(':').appendUInt(time.minute(), 2).append(':').appendUInt(time.second(), 2);
+    }
+
+    const char* c_str() const { return buffer; }
+    size_t size() const { return length; }
+    bool overflowed() const { return overflow; }
+
+private:
+    char buffer[N];
+    size_t length;
+    bool overflow;
+};
+
+#endif // MESSAGE_BUILDER_H
@@ -0,0 +1,268 @@
+#ifndef MQTT_CONNECTION_H
+#define MQTT_CONNECTION_H
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <PubSubClient.h>
+#include <lwip/dns.h>
+
+#define MQTT_DNS_TIMEOUT 2000       // ms for the broker lookup, polled without blocking
+#define MQTT_TLS_TIMEOUT 5000       // ms for the TCP connect and TLS handshake
+#define MQTT_CONNECT_TIMEOUT 3000   // ms to wait for CONNACK, whole seconds
+#define MQTT_BACKOFF_MIN 1000       // ms before the first retry
+#define MQTT_BACKOFF_MAX 300000UL   // ms cap on the retry delay
+#define MQTT_DEFER_MAX 30000        // ms the blocking phases of one attempt may wait for the caller
+
+// Brings the broker connection up one phase per step() call, so loop() keeps running between the
+// DNS lookup, the TCP + TLS handshake, the MQTT CONNECT and each SUBSCRIBE. Every phase has its
+// own timeout, a failure closes the socket and waits an exponentially growing, jittered delay
+// before starting over. BearSSL does the TCP connect and the handshake in one call, so they are
+// one phase here.
+// The lookup goes to lwIP without waiting and is polled on later steps. The TLS and CONNECT
+// phases still block for up to their timeouts, so while the caller says it may not block they
+// wait, for MQTT_DEFER_MAX per attempt at most, after which they run anyway. A broker link that
+// drops while the pump runs is therefore back within about that long.
+class MqttConnection {
+public:
+    enum Phase : uint8_t { BACKOFF, RESOLVE, TLS, CONNECT, SUBSCRIBE, CONNECTED, PHASE_COUNT };
+
+    // topicAt(i) returns the i-th topic to subscribe to, nullptr past the last one
+    MqttConnection(PubSubClient& mqtt, BearSSL::WiFiClientSecure& tls, const char* (*topicAt)(size_t))
+        : mqtt(mqtt), tls(tls), topicAt(topicAt), host(nullptr), port(0), clientId(nullptr),
+          user(nullptr), password(nullptr), phase(BACKOFF), lookupPending(false), lookupDone(false),
+          lookupFailed(false), lookupStartedMs(0),
+          deferring(false), deferStartedMs(0) {
+        reset();
+        resetStats();
+    }
+
+    void begin(const char* brokerHost, uint16_t brokerPort, const char* id, const char* brokerUser,
+               const char* brokerPassword) {
+        host = brokerHost;
+        port = brokerPort;
+        clientId = id;
+        user = brokerUser;
+        password = brokerPassword;
+        mqtt.setSocketTimeout(MQTT_CONNECT_TIMEOUT / 1000);  // Bounds the wait for CONNACK
+        reset();
+    }
+
+    // Start over on the next step(), e.g. after WiFi came back
+    void reset() {
+        phase = BACKOFF;
+        lookupPending = false;
+        deferring = false;
+        failures = 0;
+        nextAttemptMs = millis();
+        attemptStartedMs = nextAttemptMs;
+        phaseStartedMs = nextAttemptMs;
+        topicIndex = 0;
+    }
+
+    bool isConnected() const { return phase == CONNECTED; }
+    Phase getPhase() const { return phase; }
+
+    // Advances at most one phase, returns the phase it is in afterwards. With mayBlock false it
+    // starts neither the TLS handshake nor the MQTT CONNECT until MQTT_DEFER_MAX has passed.
+    Phase step(uint32_t nowMs, bool mayBlock = true) {
+        uint32_t started = millis();
+        switch (phase) {
+            case CONNECTED:
+                if (!mqtt.connected()) {
+                    Serial.printf("MQTT connection lost, state %d\n", mqtt.state());
+                    fail(nowMs);
+                }
+                return phase;
+
+            case BACKOFF:
+                if ((int32_t)(nowMs - nextAttemptMs) < 0) return phase;
+                for (uint8_t i = 0; i < PHASE_COUNT; ++i) phaseMs[i] = 0;
+                attemptStartedMs = nowMs;
+                attempts++;
+                deferring = false;
+                enter(RESOLVE, nowMs);
+                return phase;
+
+            case RESOLVE: {
+                if (!lookupPending) {
+                    ip_addr_t address;
+                    lookupDone = false;
+                    lookupFailed = false;
+                    lookupStartedMs = millis();
+                    err_t result = host ? dns_gethostbyname(host, &address, onLookup, this) : ERR_ARG;
+                    if (result == ERR_INPROGRESS) {
+                        lookupPending = true;
+                        return phase;
+                    }
+                    lookupDone = result == ERR_OK;
+                    lookupFailed = !lookupDone;
+                } else if (!lookupDone && !lookupFailed) {
+                    if (millis() - lookupStartedMs >= MQTT_DNS_TIMEOUT) fail(nowMs);
+                    return phase;
+                }
+                lookupPending = false;
+                if (lookupFailed) {
+                    fail(nowMs);
+                    break;
+                }
+                // The lookup is cached now, so the connect below does not block on DNS again
+                enter(TLS, nowMs);
+                break;
+            }
+
+            case TLS:
+                if (deferred(mayBlock)) return phase;
+                tls.setTimeout(MQTT_TLS_TIMEOUT);
+                if (!tls.connect(host, port)) {
+                    fail(nowMs);
+                    break;
+                }
+                enter(CONNECT, nowMs);
+                break;
+
+            case CONNECT:
+                if (deferred(mayBlock)) return phase;
+                // PubSubClient reuses the open socket and only sends CONNECT
+                if (!mqtt.connect(clientId, user, password)) {
+                    fail(nowMs);
+                    break;
+                }
+                topicIndex = 0;
+                enter(SUBSCRIBE, nowMs);
+                break;
+
+            case SUBSCRIBE: {
+                const char* topic = topicAt ? topicAt(topicIndex) : nullptr;
+                if (!topic) {
+                    enter(CONNECTED, nowMs);
+                    failures = 0;
+                    Serial.printf("MQTT connected in %u ms (dns %u, tls %u, connect %u, subscribe %u)\n",
+                                  millis() - attemptStartedMs, phaseMs[RESOLVE], phaseMs[TLS],
+                                  phaseMs[CONNECT], phaseMs[SUBSCRIBE]);
+                    break;
+                }
+                if (!mqtt.subscribe(topic)) {
+                    fail(nowMs);
+                    break;
+                }
+                topicIndex++;
+                break;
+            }
+
+            default:
+                break;
+        }
+        uint32_t spent = millis() - started;
+        if (spent > maxStepMs) maxStepMs = spent;
+        return phase;
+    }
+
+    // Time the last attempt spent in each phase, the longest single step() and attempt counters
+    uint32_t getPhaseMs(Phase which) const { return which < PHASE_COUNT ? phaseMs[which] : 0; }
+    uint32_t getMaxStepMs() const { return maxStepMs; }
+    uint32_t getAttempts() const { return attempts; }
+    uint32_t getFailures() const { return totalFailures; }
+    Phase getLastFailedPhase() const { return lastFailedPhase; }
+    uint32_t getBackoffMs() const { return backoffMs; }
+
+    void resetStats() {
+        for (uint8_t i = 0; i < PHASE_COUNT; ++i) phaseMs[i] = 0;
+        maxStepMs = 0;
+        attempts = 0;
+        totalFailures = 0;
+        lastFailedPhase = CONNECTED;
+        backoffMs = 0;
+    }
+
+private:
+    // lwIP answers a lookup that was not cached from its own context
+    static void onLookup(const char*, const ip_addr_t* address, void* arg) {
+        MqttConnection* connection = static_cast<MqttConnection*>(arg);
+        if (!connection->lookupPending) {
+            return;  // Timed out or reset already
+        }
+        if (address) {
+            connection->lookupDone = true;
+        } else {
+            connection->lookupFailed = true;
+        }
+    }
+
+    // True while a blocking phase has to wait for the caller. The wait is not time spent in the
+    // phase, and after MQTT_DEFER_MAX the rest of the attempt no longer waits.
+    bool deferred(bool mayBlock) {
+        if (mayBlock) return false;
+        uint32_t now = millis();
+        if (!deferring) {
+            deferring = true;
+            deferStartedMs = now;
+        }
+        if (now - deferStartedMs >= MQTT_DEFER_MAX) return false;
+        phaseStartedMs = now;
+        return true;
+    }
+
+    void enter(Phase next, uint32_t nowMs) {
+        if (phase != BACKOFF && phase != CONNECTED) phaseMs[phase] = millis() - phaseStartedMs;
+        phase = next;
+        phaseStartedMs = next == RESOLVE ? nowMs : millis();
+    }
+
+    void fail(uint32_t nowMs) {
+        // Forget the lookup, a late answer to it must not count for the next attempt
+        lookupPending = false;
+        lookupDone = false;
+        lookupFailed = false;
+
+        lastFailedPhase = phase;
+        if (phase != CONNECTED) phaseMs[phase] = millis() - phaseStartedMs;
+        totalFailures++;
+        mqtt.disconnect();
+        tls.stop();
+
+        // MQTT_BACKOFF_MIN doubled per consecutive failure up to MQTT_BACKOFF_MAX, then half of it
+        // randomised so a fleet that lost the broker together does not come back in lockstep
+        uint32_t delayMs = MQTT_BACKOFF_MIN;
+        for (uint8_t i = 0; i < failures && delayMs < MQTT_BACKOFF_MAX; ++i) delayMs <<= 1;
+        if (delayMs > MQTT_BACKOFF_MAX) delayMs = MQTT_BACKOFF_MAX;
+        delayMs = delayMs / 2 + random(delayMs / 2 + 1);
+        if (failures < 31) failures++;
+
+        backoffMs = delayMs;
+        Serial.printf("MQTT failed in phase %u after %u ms, state %d, retry in %u ms\n",
+                      lastFailedPhase, phaseMs[lastFailedPhase], mqtt.state(), delayMs);
+        nextAttemptMs = nowMs + delayMs;
+        phase = BACKOFF;
+    }
+
+    PubSubClient& mqtt;
+    BearSSL::WiFiClientSecure& tls;
+    const char* (*topicAt)(size_t);
+    const char* host;
+    uint16_t port;
+    const char* clientId;
+    const char* user;
+    const char* password;
+
+    Phase phase;
+    uint8_t failures;  // Consecutive, drives the backoff
+    uint32_t nextAttemptMs;
+    uint32_t attemptStartedMs;
+    uint32_t phaseStartedMs;
+    size_t topicIndex;
+    bool lookupPending;
+    volatile bool lookupDone;
+    volatile bool lookupFailed;
+    uint32_t lookupStartedMs;
+    bool deferring;
+    uint32_t deferStartedMs;
+
+    uint32_t phaseMs[PHASE_COUNT];
+    uint32_t maxStepMs;
+    uint32_t attempts;
+    uint32_t totalFailures;
+    Phase lastFailedPhase;
+    uint32_t backoffMs;
+};
+
+#endif // MQTT_CONNECTION_H
@@ -0,0 +1,137 @@
+#ifndef MQTT_OUTBOX_H
+#define MQTT_OUTBOX_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+// Collects QoS 0 MQTT PUBLISH packets raised during one loop() iteration and sends them to the
+// broker in a single Client::write(), so they share one TLS record and TCP segment instead of one
+// each. Packets keep their order and retained flag. A packet that does not fit behind the queued
+// ones triggers an early flush, one that does not fit at all is written on its own.
+template <size_t N>
+class MqttOutbox {
+public:
+    explicit MqttOutbox(Client& client) : client(client) { resetStats(); clear(); }
+
+    bool publish(const char* topic, const char* payload, bool retained = false) {
+        size_t topicLength = strlen(topic);
+        size_t payloadLength = strlen(payload);
+        size_t remaining = 2 + topicLength + payloadLength;
+        if (topicLength > 0xFFFF || remaining > 0x0FFFFFFF) return false;
+        size_t packetLength = 1 + lengthBytes(remaining) + remaining;
+
+        if (packetLength > N - length && !send()) return false;
+        if (packetLength > N) {
+            // Too big for the buffer, write it alone straight after the flushed ones
+            uint8_t header[5];
+            size_t headerLength = encodeHeader(header, retained, remaining);
+            uint8_t topicHeader[2] = {(uint8_t)(topicLength >> 8), (uint8_t)topicLength};
+            bool ok = client.write(header, headerLength) == headerLength &&
+                      client.write(topicHeader, 2) == 2 &&
+                      client.write((const uint8_t*)topic, topicLength) == topicLength &&
+                      client.write((const uint8_t*)payload, payloadLength) == payloadLength;
+            packets++;
+            countWrite(ok, headerLength + 2 + topicLength + payloadLength, 4);
+            return ok;
+        }
+
+        length += encodeHeader(buffer + length, retained, remaining);
+        buffer[length++] = topicLength >> 8;
+        buffer[length++] = topicLength;
+        memcpy(buffer + length, topic, topicLength);
+        length += topicLength;
+        memcpy(buffer + length, payload, payloadLength);
+        length += payloadLength;
+        queued++;
+        packets++;
+        return true;
+    }
+
+    // Sends everything queued in one write. Returns false if anything published since the last
+    // flush() or clear() did not get out, in this write or an earlier one forced by a full buffer.
+    bool flush() {
+        bool ok = send() && !lost;
+        lost = false;
+        return ok;
+    }
+
+    // Drops whatever is queued, used when the connection is gone
+    void clear() {
+        length = 0;
+        queued = 0;
+        lost = false;
+    }
+
+    size_t pending() const { return queued; }
+
+    // Packets queued, socket writes used to send them, bytes written and failed writes
+    uint32_t getPackets() const { return packets; }
+    uint32_t getWrites() const { return writes; }
+    uint32_t getBytes() const { return bytes; }
+    uint32_t getFailures() const { return failures; }
+    uint32_t getMaxCoalesced() const { return maxCoalesced; }
+
+    void resetStats() {
+        packets = 0;
+        writes = 0;
+        bytes = 0;
+        failures = 0;
+        maxCoalesced = 0;
+    }
+
+private:
+    static size_t lengthBytes(size_t remaining) {
+        size_t count = 1;
+        while (remaining >= 128) {
+            remaining >>= 7;
+            count++;
+        }
+        return count;
+    }
+
+    // Fixed header: PUBLISH, QoS 0, retain bit, then the variable length remaining length
+    static size_t encodeHeader(uint8_t* out, bool retained, size_t remaining) {
+        size_t count = 0;
+        out[count++] = 0x30 | (retained ? 0x01 : 0x00);
+        do {
+            uint8_t digit = remaining % 128;
+            remaining /= 128;
+            if (remaining > 0) digit |= 0x80;
+            out[count++] = digit;
+        } while (remaining > 0);
+        return count;
+    }
+
+    bool send() {
+        if (length == 0) return true;
+        bool ok = client.write(buffer, length) == length;
+        countWrite(ok, length, 1);
+        if (queued > maxCoalesced) maxCoalesced = queued;
+        length = 0;
+        queued = 0;
+        return ok;
+    }
+
+    void countWrite(bool ok, size_t written, uint32_t calls) {
+        writes += calls;
+        if (ok) {
+            bytes += written;
+        } else {
+            failures++;
+            lost = true;
+        }
+    }
+
+    Client& client;
+    uint8_t buffer[N];
+    size_t length;
+    size_t queued;
+    bool lost;  // A write failed since the last flush() or clear()
+    uint32_t packets;
+    uint32_t writes;
+    uint32_t bytes;
+    uint32_t failures;
+    uint32_t maxCoalesced;
+};
+
+#endif // MQTT_OUTBOX_H
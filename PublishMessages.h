@@ -0,0 +1,66 @@
+#ifndef PUBLISH_MESSAGES_H
+#define PUBLISH_MESSAGES_H
+
+#include <Arduino.h>
+#include "MessageBuilder.h"
+#include "MCP7940_Scheduler.h"
+#include "RunAccumulator.h"
+
+// The payloads the sketch publishes, built in fixed buffers. Each build returns false when the
+// message did not fit, the caller then drops it rather than publishing a truncated payload.
+
+// {"payload":"...","timestamp":"..."}, the envelope of the status messages
+typedef MessageBuilder<128> StatusMessage;
+
+// JSON array of "index:hour:minute:duration:daysOfWeek" strings, sized for all MAX_SCHEDULES
+// entries (32 x 21 bytes)
+typedef MessageBuilder<704> ScheduleListMessage;
+
+typedef MessageBuilder<192> RunSummaryMessage;
+
+inline bool buildStatusMessage(StatusMessage& message, const char* payload, const char* timestamp) {
+    message.clear();
+    message.append("{\"payload\":\"").append(payload)
+           .append("\",\"timestamp\":\"").append(timestamp)
+           .append("\"}");
+    return !message.overflowed();
+}
+
+inline bool buildScheduleList(ScheduleListMessage& list, const WateringSchedules& schedules) {
+    list.clear();
+    list.append('[');
+    bool first = true;
+    for (int i = 0; i < MAX_SCHEDULES; i++) {
+        const ScheduleItem& item = schedules.items[i];
+
+        // Add only enabled schedules, corrupt slots were already reset when the schedules were loaded
+        if (item.enabled) {
+            if (!first) list.append(',');
+            first = false;
+            list.append('"')
+                .appendUInt(i).append(':')
+                .appendUInt(item.hour).append(':')
+                .appendUInt(item.minute).append(':')
+                .appendUInt(item.duration_sec).append(':')
+                .appendUInt(item.daysOfWeek)
+                .append('"');
+        }
+    }
+    list.append(']');
+    return !list.overflowed();
+}
+
+inline bool buildRunSummary(RunSummaryMessage& summary, const RunAccumulator& run, const char* timestamp) {
+    summary.clear();
+    summary.append("{\"runtime_ms\":").appendUInt(run.getRuntimeMs())
+           .append(",\"charge_uah\":").appendUInt(run.getChargeUah())
+           .append(",\"energy_uwh\":").appendUInt(run.getEnergyUwh())
+           .append(",\"avg_ma\":").appendUInt(run.getAverageMa())
+           .append(",\"peak_ma\":").appendUInt(run.getPeakMa())
+           .append(",\"stop\":\"").append(RunAccumulator::reasonName(run.getStopReason()))
+           .append("\",\"timestamp\":\"").append(timestamp)
+           .append("\"}");
+    return !summary.overflowed();
+}
+
+#endif // PUBLISH_MESSAGES_H
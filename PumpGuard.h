@@ -0,0 +1,124 @@
+#ifndef PUMP_GUARD_H
+#define PUMP_GUARD_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "objects.h"
+#include "I2CBus.h"
+#include "CurrentMonitor.h"
+#include "RunAccumulator.h"
+
+// Reads the INA219 and checks every sample against the CurrentMonitor limits from the sampler
+// Timer itself, so a trip cuts the pump without waiting for loop(), which can sit in a network
+// call for seconds. This is the one place Ticker context uses I2C: a tick that lands while loop()
+// holds the bus (I2CBus.h) skips its reading and counts it, the next tick 50 ms later reads
+// again. The sampler only drives the MOSFET low and records the trip, loop() picks it up with
+// takeTrip() for the logging and publishing.
+class PumpGuard {
+public:
+    typedef CurrentMonitor<CURRENT_WINDOW> Monitor;
+
+    PumpGuard(Monitor& monitor, RunAccumulator& run)
+        : monitor(monitor), run(run), latestCentiMa(0), voltageCountdown(0), pendingTrip(Monitor::NONE),
+          readFailures(0), busySkips(0) {}
+
+    // Start of a run, the pump has just been switched on
+    void begin(uint32_t nowMs) {
+        monitor.reset(nowMs);
+        run.begin(nowMs);
+        voltageCountdown = 0;
+        pendingTrip = Monitor::NONE;
+    }
+
+    // One sampler tick: a current reading, the bus voltage about once a second, and the trip
+    // check. Returns the trip reason on the tick the pump was cut.
+    Monitor::Trip sample(uint32_t nowMs) {
+        if (!digitalRead(MOSFET_PIN)) {
+            return Monitor::NONE;
+        }
+        if (I2CBus::busy()) {
+            busySkips++;
+            return Monitor::NONE;
+        }
+        I2CBusLock busLock;
+        if (!readCurrentCentiMa(latestCentiMa)) {
+            readFailures++;
+            return Monitor::NONE;
+        }
+
+        if (run.getSamples() == 0 || voltageCountdown == 0) {
+            uint32_t busMv;
+            if (readBusMillivolts(busMv)) {
+                run.setBusVoltage(busMv);
+            }
+            voltageCountdown = 1000 / CURRENT_SAMPLE_INTERVAL;
+        }
+        voltageCountdown--;
+        run.addCurrent(latestCentiMa, nowMs);
+
+        Monitor::Trip trip = monitor.addSample(latestCentiMa, nowMs);
+        if (trip != Monitor::NONE) {
+            digitalWrite(MOSFET_PIN, LOW);
+            run.end(nowMs, trip == Monitor::DRY_RUN ? STOP_DRY_RUN : STOP_OVER_CURRENT);
+            pendingTrip = trip;
+        }
+        return trip;
+    }
+
+    // The trip the sampler acted on since the last call, for loop() to finish the stop
+    Monitor::Trip takeTrip() {
+        Monitor::Trip trip = pendingTrip;
+        pendingTrip = Monitor::NONE;
+        return trip;
+    }
+
+    int32_t getLatestCentiMa() const { return latestCentiMa; }
+    uint32_t getReadFailures() const { return readFailures; }
+    uint32_t getBusySkips() const { return busySkips; }
+
+    // Reads an INA219 register straight off the bus, the library getters convert through float
+    static bool readRegister(uint8_t reg, uint16_t& value) {
+        Wire.beginTransmission(INA219_I2C_ADDR);
+        Wire.write(reg);
+        if (Wire.endTransmission() != 0) {
+            return false;
+        }
+        if (Wire.requestFrom((uint8_t)INA219_I2C_ADDR, (uint8_t)2) != 2) {
+            return false;
+        }
+        value = (uint16_t)Wire.read() << 8;
+        value |= Wire.read();
+        return true;
+    }
+
+    // Shunt register is 10 uV per bit, so mA x 100 = raw * 10 uV / R mOhm * 100
+    static bool readCurrentCentiMa(int32_t& centiMa) {
+        uint16_t raw;
+        if (!readRegister(INA219_REG_SHUNT, raw)) {
+            return false;
+        }
+        centiMa = (int32_t)(int16_t)raw * 1000 / SHUNT_MILLIOHM;
+        return true;
+    }
+
+    // Bus register holds the voltage in bits 15..3, 4 mV per bit
+    static bool readBusMillivolts(uint32_t& millivolts) {
+        uint16_t raw;
+        if (!readRegister(INA219_REG_BUS, raw)) {
+            return false;
+        }
+        millivolts = (uint32_t)(raw >> 3) * 4;
+        return true;
+    }
+
+private:
+    Monitor& monitor;
+    RunAccumulator& run;
+    int32_t latestCentiMa;
+    uint8_t voltageCountdown;
+    volatile Monitor::Trip pendingTrip;  // Set from the sampler, cleared by loop()
+    uint32_t readFailures;
+    uint32_t busySkips;  // Ticks that found loop() in a Wire transfer
+};
+
+#endif // PUMP_GUARD_H
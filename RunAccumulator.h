@@ -0,0 +1,85 @@
+#ifndef RUN_ACCUMULATOR_H
+#define RUN_ACCUMULATOR_H
+
+#include <Arduino.h>
+
+enum StopReason : uint8_t {
+    STOP_MANUAL,
+    STOP_ALARM,
+    STOP_DRY_RUN,
+    STOP_OVER_CURRENT,
+};
+
+// Integrates pump current and bus voltage over one run, from pumpStart() to pumpStop(). Current
+// comes in as mA x 100 and all sums are integers, so a long run loses no precision to float
+// rounding. Each current sample is held for the time since the previous one, the bus
+// voltage is only refreshed now and then since it barely moves while the pump runs.
+class RunAccumulator {
+public:
+    RunAccumulator() { begin(0); running = false; }
+
+    void begin(uint32_t nowMs) {
+        startedMs = nowMs;
+        lastSampleMs = nowMs;
+        runtimeMs = 0;
+        chargeCentiMaMs = 0;
+        energyCentiUwMs = 0;
+        busMv = 0;
+        peakCentiMa = 0;
+        samples = 0;
+        reason = STOP_MANUAL;
+        running = true;
+    }
+
+    void setBusVoltage(uint32_t millivolts) { busMv = millivolts; }
+
+    void addCurrent(int32_t currentCentiMa, uint32_t nowMs) {
+        if (!running) return;
+        if (currentCentiMa < 0) currentCentiMa = 0;  // Shunt offset around zero while the motor spins up
+        uint32_t dt = nowMs - lastSampleMs;
+        lastSampleMs = nowMs;
+        chargeCentiMaMs += (uint64_t)currentCentiMa * dt;
+        energyCentiUwMs += (uint64_t)currentCentiMa * busMv * dt;
+        if ((uint32_t)currentCentiMa > peakCentiMa) peakCentiMa = currentCentiMa;
+        samples++;
+    }
+
+    void end(uint32_t nowMs, StopReason stopReason) {
+        if (!running) return;
+        runtimeMs = nowMs - startedMs;
+        reason = stopReason;
+        running = false;
+    }
+
+    bool isRunning() const { return running; }
+    uint32_t getRuntimeMs() const { return runtimeMs; }
+    uint32_t getChargeUah() const { return chargeCentiMaMs / 360000ULL; }
+    uint32_t getEnergyUwh() const { return energyCentiUwMs / 360000000ULL; }
+    uint32_t getPeakMa() const { return peakCentiMa / 100; }
+    uint32_t getAverageMa() const { return runtimeMs ? chargeCentiMaMs / runtimeMs / 100 : 0; }
+    uint32_t getSamples() const { return samples; }
+    StopReason getStopReason() const { return reason; }
+
+    static const char* reasonName(StopReason stopReason) {
+        switch (stopReason) {
+            case STOP_ALARM: return "alarm";
+            case STOP_DRY_RUN: return "dry_run";
+            case STOP_OVER_CURRENT: return "over_current";
+            default: return "manual";
+        }
+    }
+
+private:
+    uint32_t startedMs;
+    uint32_t lastSampleMs;
+    uint32_t runtimeMs;
+    uint64_t chargeCentiMaMs;
+    uint64_t energyCentiUwMs;
+    uint32_t busMv;
+    uint32_t peakCentiMa;
+    uint32_t samples;
+    StopReason reason;
+    bool running;
+};
+
+#endif // RUN_ACCUMULATOR_H
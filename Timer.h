@@ -1,29 +1,89 @@
 #include <Ticker.h>
 
+#define TIMER_TICK_MS 50       // Resolution of every Timer, intervals are rounded up to whole ticks
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+class Timer;
+
+// Two-level hierarchical timer wheel driven by a single Ticker. Level 0 holds timers due within
+// the next 64 ticks, level 1 holds later ones in 64-tick buckets that are cascaded down as the
+// wheel turns. Timers further out than level 1 reaches are parked in its last bucket and
+// re-filed each time it cascades. Periodic timers are aligned to a multiple of their period, so
+// timers with related periods fire on the same tick and share one wakeup.
+// Timers are started and stopped from loop() and run from the Ticker's SYS context, which does
+// not preempt loop() on the ESP8266, so the lists need no locking.
+class TimerWheel {
+public:
+    static TimerWheel& instance() {
+        static TimerWheel wheel;
+        return wheel;
+    }
+
+    void add(Timer* timer, bool aligned);
+    void remove(Timer* timer);
+
+    uint32_t now() const { return currentTick; }
+
+    // Largest deviation of the tick period from TIMER_TICK_MS, and the most work done in one tick
+    uint32_t getMaxJitterMs() const { return maxJitterMs; }
+    uint32_t getMaxJobsPerTick() const { return maxJobsPerTick; }
+    uint32_t getMaxTickMicros() const { return maxTickMicros; }
+    uint32_t getTicks() const { return ticks; }
+
+    void resetStats() {
+        maxJitterMs = 0;
+        maxJobsPerTick = 0;
+        maxTickMicros = 0;
+        ticks = 0;
+    }
+
+private:
+    TimerWheel() : currentTick(0), activeTimers(0), attached(false), lastTickMillis(0),
+                   maxJitterMs(0), maxJobsPerTick(0), maxTickMicros(0), ticks(0) {
+        for (int i = 0; i < TIMER_WHEEL_SLOTS; ++i) {
+            level0[i] = nullptr;
+            level1[i] = nullptr;
+        }
+    }
+
+    static void onTick() { instance().tick(); }
+    void tick();
+    void file(Timer* timer);
+    static void link(Timer*& head, Timer* timer);
+    static void unlink(Timer* timer);
+
+    Ticker ticker;
+    Timer* level0[TIMER_WHEEL_SLOTS];
+    Timer* level1[TIMER_WHEEL_SLOTS];
+    uint32_t currentTick;
+    uint16_t activeTimers;
+    bool attached;
+    uint32_t lastTickMillis;
+    uint32_t maxJitterMs;
+    uint32_t maxJobsPerTick;
+    uint32_t maxTickMicros;
+    uint32_t ticks;
+};
+
 class Timer {
 public:
     enum TimerType { SCHEDULER, ONESHOT };
 
-    Timer(unsigned long interval, TimerType type, void (*task)()) 
-        : intervalMs(interval), timerType(type), callback(task), running(false) {}
+    Timer(unsigned long interval, TimerType type, void (*task)())
+        : intervalMs(interval), timerType(type), callback(task), running(false),
+          expires(0), next(nullptr), pprev(nullptr) {}
 
     void start() {
         if (running || !callback) return;
-
-        if (timerType == SCHEDULER) {
-            ticker.attach_ms(intervalMs, callback);
-        } else {
-            ticker.once_ms(intervalMs, [this]() {
-                if (callback) callback();
-                stop();
-            });
-        }
         running = true;
+        TimerWheel::instance().add(this, timerType == SCHEDULER);
     }
 
     void stop() {
         if (!running) return;
-        ticker.detach();
+        TimerWheel::instance().remove(this);
         running = false;
     }
 
@@ -49,9 +109,118 @@ public:
     bool isRunning() const { return running; }
 
 private:
-    Ticker ticker;
+    friend class TimerWheel;
+
+    uint32_t periodTicks() const {
+        uint32_t period = (intervalMs + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+        return period > 0 ? period : 1;
+    }
+
     unsigned long intervalMs;
     TimerType timerType;
     void (*callback)();
     bool running;
+    uint32_t expires;  // Wheel tick the timer is due on
+    Timer* next;       // Intrusive list of the wheel slot the timer is filed in
+    Timer** pprev;
 };
+
+inline void TimerWheel::link(Timer*& head, Timer* timer) {
+    timer->next = head;
+    if (head) head->pprev = &timer->next;
+    head = timer;
+    timer->pprev = &head;
+}
+
+inline void TimerWheel::unlink(Timer* timer) {
+    if (!timer->pprev) return;
+    *timer->pprev = timer->next;
+    if (timer->next) timer->next->pprev = timer->pprev;
+    timer->next = nullptr;
+    timer->pprev = nullptr;
+}
+
+inline void TimerWheel::file(Timer* timer) {
+    uint32_t delta = timer->expires - currentTick;
+    if (delta < TIMER_WHEEL_SLOTS) {
+        link(level0[timer->expires & TIMER_WHEEL_MASK], timer);
+    } else if (delta < (uint32_t)(TIMER_WHEEL_SLOTS - 1) << TIMER_WHEEL_BITS) {
+        link(level1[(timer->expires >> TIMER_WHEEL_BITS) & TIMER_WHEEL_MASK], timer);
+    } else {
+        // Beyond level 1, park in the furthest bucket and re-file when it cascades
+        link(level1[((currentTick >> TIMER_WHEEL_BITS) + TIMER_WHEEL_SLOTS - 1) & TIMER_WHEEL_MASK], timer);
+    }
+}
+
+inline void TimerWheel::add(Timer* timer, bool aligned) {
+    uint32_t period = timer->periodTicks();
+    if (aligned) {
+        // Next multiple of the period, so timers with related periods coalesce
+        timer->expires = (currentTick / period + 1) * period;
+    } else {
+        timer->expires = currentTick + period;
+    }
+    file(timer);
+
+    if (activeTimers++ == 0 && !attached) {
+        lastTickMillis = millis();
+        ticker.attach_ms(TIMER_TICK_MS, onTick);
+        attached = true;
+    }
+}
+
+inline void TimerWheel::remove(Timer* timer) {
+    unlink(timer);
+    if (activeTimers > 0 && --activeTimers == 0 && attached) {
+        ticker.detach();  // Nothing left to run, stop waking up
+        attached = false;
+    }
+}
+
+inline void TimerWheel::tick() {
+    uint32_t started = micros();
+    uint32_t nowMillis = millis();
+    uint32_t elapsed = nowMillis - lastTickMillis;
+    uint32_t jitter = elapsed > TIMER_TICK_MS ? elapsed - TIMER_TICK_MS : TIMER_TICK_MS - elapsed;
+    if (jitter > maxJitterMs) maxJitterMs = jitter;
+    lastTickMillis = nowMillis;
+
+    currentTick++;
+    ticks++;
+
+    // Every 64 ticks the next level 1 bucket moves down into level 0
+    if ((currentTick & TIMER_WHEEL_MASK) == 0) {
+        Timer* cascade = level1[(currentTick >> TIMER_WHEEL_BITS) & TIMER_WHEEL_MASK];
+        level1[(currentTick >> TIMER_WHEEL_BITS) & TIMER_WHEEL_MASK] = nullptr;
+        if (cascade) cascade->pprev = &cascade;
+        while (cascade) {
+            Timer* timer = cascade;
+            unlink(timer);
+            file(timer);
+        }
+    }
+
+    // Detach the due slot first, so callbacks may start or stop any timer
+    Timer* due = level0[currentTick & TIMER_WHEEL_MASK];
+    level0[currentTick & TIMER_WHEEL_MASK] = nullptr;
+    if (due) due->pprev = &due;
+
+    uint32_t jobs = 0;
+    while (due) {
+        Timer* timer = due;
+        unlink(timer);
+        if (timer->timerType == Timer::SCHEDULER) {
+            timer->expires += timer->periodTicks();
+            file(timer);
+        } else {
+            timer->running = false;
+            remove(timer);
+        }
+        timer->callback();
+        jobs++;
+    }
+
+    if (jobs > maxJobsPerTick) maxJobsPerTick = jobs;
+    uint32_t spent = micros() - started;
+    if (spent > maxTickMicros) maxTickMicros = spent;
+}
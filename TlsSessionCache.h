@@ -0,0 +1,86 @@
+#ifndef TLS_SESSION_CACHE_H
+#define TLS_SESSION_CACHE_H
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+
+#define TLS_SESSION_RTC_BLOCK 32      // RTC user memory block, the first 128 bytes belong to the OTA loader
+#define TLS_SESSION_MAGIC 0x544C5331  // "TLS1"
+
+// TLS sessions for the broker and the update host, handed to the shared client with setSession()
+// so a reconnect resumes the session instead of doing a full handshake. A copy is kept in RTC user
+// memory, which survives a restart but not a power cycle, so the first connection after a reboot
+// can resume as well. BearSSL::Session is a plain wrapper around br_ssl_session_parameters, so the
+// objects are copied byte for byte.
+class TlsSessionCache {
+public:
+    BearSSL::Session mqtt;
+    BearSSL::Session ota;
+
+    TlsSessionCache() { memset(&stored, 0, sizeof(stored)); }
+
+    // Load the sessions saved before the last restart, returns false if there were none
+    bool restore() {
+        if (!ESP.rtcUserMemoryRead(TLS_SESSION_RTC_BLOCK, reinterpret_cast<uint32_t*>(&stored), sizeof(stored)) ||
+            stored.magic != TLS_SESSION_MAGIC || stored.crc != crc32(stored)) {
+            memset(&stored, 0, sizeof(stored));
+            return false;
+        }
+        memcpy(static_cast<void*>(&mqtt), stored.mqtt, sizeof(BearSSL::Session));
+        memcpy(static_cast<void*>(&ota), stored.ota, sizeof(BearSSL::Session));
+        return true;
+    }
+
+    // Call after a connection was made with the session. A resumed handshake leaves the session
+    // untouched, a full one replaces it and the new one is written to RTC memory.
+    bool noteHandshake(const BearSSL::Session& session) {
+        uint8_t* copy = &session == &mqtt ? stored.mqtt : stored.ota;
+        bool resumed = !isEmpty(copy) && memcmp(copy, &session, sizeof(BearSSL::Session)) == 0;
+        if (!resumed) {
+            memcpy(copy, &session, sizeof(BearSSL::Session));
+            save();
+        }
+        return resumed;
+    }
+
+private:
+    // Session copies padded to whole 4-byte blocks, RTC user memory is accessed in blocks
+    static const size_t SLOT_SIZE = (sizeof(BearSSL::Session) + 3) & ~(size_t)3;
+
+    struct Record {
+        uint32_t magic;
+        uint32_t crc;  // CRC-32 over both sessions
+        uint8_t mqtt[SLOT_SIZE];
+        uint8_t ota[SLOT_SIZE];
+    };
+    static_assert(TLS_SESSION_RTC_BLOCK * 4 + sizeof(Record) <= 512, "TLS sessions do not fit RTC user memory");
+
+    void save() {
+        stored.magic = TLS_SESSION_MAGIC;
+        stored.crc = crc32(stored);
+        ESP.rtcUserMemoryWrite(TLS_SESSION_RTC_BLOCK, reinterpret_cast<uint32_t*>(&stored), sizeof(stored));
+    }
+
+    static bool isEmpty(const uint8_t* session) {
+        for (size_t i = 0; i < sizeof(BearSSL::Session); ++i) {
+            if (session[i]) return false;
+        }
+        return true;
+    }
+
+    static uint32_t crc32(const Record& record) {
+        const uint8_t* data = record.mqtt;
+        uint32_t crc = 0xFFFFFFFF;
+        for (size_t i = 0; i < sizeof(record.mqtt) + sizeof(record.ota); ++i) {
+            crc ^= data[i];
+            for (uint8_t bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+            }
+        }
+        return ~crc;
+    }
+
+    Record stored;
+};
+
+#endif // TLS_SESSION_CACHE_H
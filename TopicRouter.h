@@ -0,0 +1,69 @@
+#ifndef TOPIC_ROUTER_H
+#define TOPIC_ROUTER_H
+
+#include <Arduino.h>
+#include "MCP7940_Scheduler.h"
+
+// Handlers receive the payload as a bounded view, it is not NUL terminated
+typedef void (*TopicHandler)(const char* payload, size_t length);
+
+struct TopicRoute {
+    const char* topic;
+    size_t length;
+    TopicHandler handler;
+};
+
+#define TOPIC_ROUTE(topic, handler) { topic, sizeof(topic) - 1, handler }
+
+// Calls the handler of the route matching topic, false if there is none. Matching compares
+// lengths first, so a message only pays for a memcmp against topics of the same length.
+template <size_t N>
+bool routeTopic(const TopicRoute (&routes)[N], const char* topic, const char* payload, size_t length) {
+    size_t topicLength = strlen(topic);
+    for (const TopicRoute& route : routes) {
+        if (route.length == topicLength && memcmp(route.topic, topic, topicLength) == 0) {
+            route.handler(payload, length);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Parses one unsigned decimal field of a colon separated payload starting at pos. The field must
+// be followed by ':' (consumed) or, for the last field, by the end of the payload.
+inline bool parseField(const char* payload, size_t length, size_t& pos, uint32_t max, bool last, uint32_t& value) {
+    size_t start = pos;
+    value = 0;
+    while (pos < length && payload[pos] >= '0' && payload[pos] <= '9') {
+        value = value * 10 + (payload[pos++] - '0');
+        if (value > max) return false;
+    }
+    if (pos == start) return false;
+    if (last) return pos == length;
+    if (pos >= length || payload[pos] != ':') return false;
+    pos++;
+    return true;
+}
+
+// It parses the payload for setting a schedule: "index:HH:MM:duration:daysOfWeek:enabled"
+inline bool parseSchedulePayload(const char* payload, size_t length, int& index, ScheduleItem& item) {
+    size_t pos = 0;
+    uint32_t fields[6];
+    static const uint32_t limits[6] = {MAX_SCHEDULES - 1, 23, 59, UINT16_MAX, DOW_EVERYDAY, 1};
+
+    for (int i = 0; i < 6; i++) {
+        if (!parseField(payload, length, pos, limits[i], i == 5, fields[i])) {
+            return false;
+        }
+    }
+
+    index = fields[0];
+    item.hour = fields[1];
+    item.minute = fields[2];
+    item.duration_sec = fields[3];
+    item.daysOfWeek = fields[4];
+    item.enabled = fields[5] == 1;
+    return true;
+}
+
+#endif // TOPIC_ROUTER_H
@@ -6,29 +6,60 @@
 #include <ESP8266HTTPClient.h>
 #include <ESP8266httpUpdate.h>               
 #include <EEPROM.h>            // Use LittleFS instead of SPIFFS
-#include <ArduinoJson.h>
 #include <INA219.h>
 #include <DoubleResetDetect.h>
 
 //custom header
 #include "Timer.h"
+#include "EventQueue.h"
+#include "CurrentMonitor.h"
+#include "RunAccumulator.h"
+#include "PumpGuard.h"
 #include "objects.h"
 #include "MCP7940_Scheduler.h"
+#include "MessageBuilder.h"
+#include "PublishMessages.h"
+#include "MqttOutbox.h"
+#include "MqttConnection.h"
+#include "TlsSessionCache.h"
+#include "TopicRouter.h"
 #include "helper.h"
 
 BearSSL::WiFiClientSecure espClient;
+TlsSessionCache tlsSessions;  // Broker and update host sessions, espClient resumes whichever is set
 PubSubClient mqttClient(espClient);
+MqttOutbox<MQTT_OUTBOX_SIZE> outbox(espClient);  // Publishes go out together at the end of loop()
+const char* subscriptionTopic(size_t index);
+MqttConnection mqttConnection(mqttClient, espClient, subscriptionTopic);
 MCP7940Scheduler rtc;
 Adafruit_NeoPixel led(NUM_LEDS, LED_PIN, NEO_GRB + NEO_KHZ800);
 LedColor ledColorPicker[2] = {LedColor::RED,LedColor::OFF};
 State deviceState;
+Hardconfig hardconfig;
 INA219 INA(INA219_I2C_ADDR);
 DoubleResetDetect drd(DRD_TIMEOUT, DRD_ADDRESS);
+EventQueue<DeferredEvent, EVENT_QUEUE_SIZE> events;
 
 bool picker = false;
 bool resetTrigger = false;
-bool mqttloop,firmwareUpdate,firmwareUpdateOngoing;
-float current  = 0;
+bool firmwareUpdate,firmwareUpdateOngoing;
+bool inaReady = false;
+CurrentMonitor<CURRENT_WINDOW> currentMonitor(hardconfig.motorCutoffThreshold * 100, hardconfig.overCurrentThreshold * 100,
+                                              INRUSH_GRACE_MS, CURRENT_TRIP_SAMPLES);
+RunAccumulator pumpRun;
+PumpGuard pumpGuard(currentMonitor, pumpRun);
+bool runSummaryPending = false;
+bool runSummaryQueued = false;  // In the outbox, pending until the flush gets it out
+uint32_t eventsDroppedReported = 0;
+// Sampling runs only while the pump does, started by pumpStart() and stopped by pumpStop().
+// The trip check runs right here, a queued sample would wait for loop() and be dropped while
+// a network call blocks it.
+Timer currentSampler(CURRENT_SAMPLE_INTERVAL, Timer::SCHEDULER, []() {
+  if (pumpGuard.sample(millis()) != PumpGuard::Monitor::NONE) {
+    currentSampler.stop();
+  }
+});
+
 volatile unsigned long lastClickTime = 0;
 volatile uint8_t clickCount = 0;
 unsigned long lastButtonCheckTime = 0;
@@ -64,19 +95,22 @@ void saveConfigCallback() {
 
   Serial.println("Saving config...");
   eeprom_saveconfig();
+  rtc.flushSchedules(true);
   ESP.restart();
 }
 
 void configPotrtalTimeoutCalback() {
   if (!digitalRead(MOSFET_PIN)) {
+    rtc.flushSchedules(true);
     wm.reboot();
   }
 }
 
 void gracefullShutownprep(){
+  rtc.flushSchedules(true);  // Schedule edits still waiting for their EEPROM commit
   mqttClient.disconnect();
   wm.disconnect();
-  pumpStop();
+  pumpStop(STOP_MANUAL);
   led.setPixelColor(0,LedColor::OFF);
   led.show();
 }
@@ -101,6 +135,15 @@ void IRAM_ATTR buttonISR() {
   lastClickTime = now;
 }
 
+#ifdef RTC_MFP_PIN
+volatile bool rtcAlarmPending = false;
+
+// MFP rises when an enabled alarm fires; the flags are read and cleared from loop()
+void IRAM_ATTR rtcAlarmISR() {
+  rtcAlarmPending = true;
+}
+#endif
+
 // Method to generate the string in the format "prefix_chipID_last4mac"
 String generateDeviceID() {
   // Get the chip ID
@@ -144,112 +187,85 @@ void setupWiFi() {
 
 }
 
-void mqttCallback(char *topic, byte *payload, unsigned int length) {
-  Serial.print("Message arrived [");
-  Serial.print(topic);
-  Serial.print("] ");
+void onPumpControl(const char* payload, size_t length) {
+  size_t pos = 0;
+  uint32_t duration;
+  if (!parseField(payload, length, pos, UINT16_MAX, true, duration)) {
+    Serial.println("Invalid pump trigger, expected a duration in seconds.");
+    return;
+  }
 
-  char payloadStr[length + 1];
-  strncpy(payloadStr, (char *)payload, length);
-  payloadStr[length] = '\0';
-  Serial.println(payloadStr);
-
-  if (strcmp(topic, PUMP_CONTROL_TOPIC) == 0) {
-    int duration = atoi(payloadStr);
-
-    if (duration == 0) {
-      // If payload is "0", stop the pump.
-      pumpStop();
-    } else if (duration > 0) {
-      // If payload is a positive number, start the pump with that duration.
-      pumpStart();
-      rtc.setManualStopTime(duration);
-    }
-  } else if (strcmp(topic, SET_SCHEDULE) == 0) {
-    onSetScheduleCallback(payloadStr);
-    // Only apply the changes immediately if the pump is not running.
-    if (!digitalRead(MOSFET_PIN)) {
-      updateAndPublishNextAlarm();
-    }
-  } else if (strcmp(topic, REQUEST_ALL_SCHEDULES) == 0) {
-    WateringSchedules allSchedules;
-    rtc.getSchedules(allSchedules);
-
-    // This JSON document is for building the array. 512 bytes is a safe size.
-    DynamicJsonDocument doc(512);
-    JsonArray scheduleArray = doc.to<JsonArray>();
-
-    // A small buffer to build each schedule string (max 18 bytes needed)
-    char schedule_string[20]; 
-    bool schedulesModified = false;
-
-    for (int i = 0; i < MAX_SCHEDULES; i++) {
-        auto& item = allSchedules.items[i];
-
-        // 1. Validate and fix any corrupt data in RTC memory
-        if (item.hour > 23 || item.minute > 59 || item.daysOfWeek > 127) {
-            item.hour = 0;
-            item.minute = 0;
-            item.duration_sec = 0;
-            item.daysOfWeek = 0;
-            item.enabled = false;
-            schedulesModified = true;
-        }
+  if (duration == 0) {
+    // If payload is "0", stop the pump.
+    pumpStop(STOP_MANUAL);
+  } else {
+    // If payload is a positive number, start the pump with that duration.
+    pumpStart();
+    rtc.setManualStopTime(duration);
+  }
+}
 
-        // 2. Add only valid AND enabled schedules to our response array
-        if (item.enabled) {
-            // Format: index:hour:minute:duration:daysOfWeek
-            snprintf(schedule_string, sizeof(schedule_string), "%d:%d:%d:%u:%d",
-                     i,
-                     item.hour,
-                     item.minute,
-                     item.duration_sec,
-                     item.daysOfWeek);
-            
-            scheduleArray.add(schedule_string);
-        }
-    }
+void onSetSchedule(const char* payload, size_t length) {
+  onSetScheduleCallback(payload, length);
+  // Only apply the changes immediately if the pump is not running.
+  if (!digitalRead(MOSFET_PIN)) {
+    updateAndPublishNextAlarm();
+  }
+}
 
-    // 3. If data was fixed, write the clean version back to the RTC
-    if (schedulesModified) {
-        Serial.println("Found and fixed corrupt schedule data in RTC RAM.");
-        rtc.setSchedules(allSchedules);
-    }
+void onRequestAllSchedules(const char* payload, size_t length) {
+  WateringSchedules allSchedules;
+  rtc.getSchedules(allSchedules);
 
-    // 4. Serialize the final JSON array into a single buffer and publish
-    char payload_buffer[256]; // Safely fits the max possible payload (~202 bytes)
-    serializeJson(doc, payload_buffer, sizeof(payload_buffer));
-    
-    mqttClient.publish(GET_ALL_SCHEDULES, payload_buffer);
-  } else if (strcmp(topic, GET_UPDATE_REQUEST) == 0) {
-    if (atoi(payloadStr) == 1) {
-      firmwareUpdate = true;
-    }
-  } else if (strcmp(topic, RESTART) == 0) {
-    gracefullShutownprep();
-    ESP.restart();
+  // Static to keep it off the stack
+  static ScheduleListMessage scheduleList;
+  if (!buildScheduleList(scheduleList, allSchedules)) {
+    Serial.println("Schedule list too long, not sent");
+    return;
+  }
+  outbox.publish(GET_ALL_SCHEDULES, scheduleList.c_str());
+}
+
+void onUpdateRequest(const char* payload, size_t length) {
+  if (length == 1 && payload[0] == '1') {
+    firmwareUpdate = true;
   }
-   else {
+}
+
+void onRestart(const char* payload, size_t length) {
+  gracefullShutownprep();
+  ESP.restart();
+}
+
+// Every topic the device subscribes to and its handler
+constexpr TopicRoute topicRoutes[] = {
+  TOPIC_ROUTE(PUMP_CONTROL_TOPIC, onPumpControl),
+  TOPIC_ROUTE(SET_SCHEDULE, onSetSchedule),
+  TOPIC_ROUTE(REQUEST_ALL_SCHEDULES, onRequestAllSchedules),
+  TOPIC_ROUTE(GET_UPDATE_REQUEST, onUpdateRequest),
+  TOPIC_ROUTE(RESTART, onRestart),
+};
+
+void mqttCallback(char *topic, byte *payload, unsigned int length) {
+  Serial.print("Message arrived [");
+  Serial.print(topic);
+  Serial.print("] ");
+  Serial.write(payload, length);
+  Serial.println();
+
+  if (!routeTopic(topicRoutes, topic, (const char *)payload, length)) {
     Serial.print("Topic action not found");
   }
 }
 
 // Callback for SET_SCHEDULE
-void onSetScheduleCallback(const char* payload) {
+void onSetScheduleCallback(const char* payload, size_t length) {
     int index;
     ScheduleItem newItem;
     
-    if (parseSchedulePayload(payload, index, newItem)) {
-        WateringSchedules allSchedules;
-        
-        if (!rtc.getSchedules(allSchedules)) {
-            Serial.println("Could not read schedules, initializing new set.");
-            memset(&allSchedules, 0, sizeof(allSchedules));
-        }
-
-        allSchedules.items[index] = newItem;
-
-        if (rtc.setSchedules(allSchedules)) {
+    if (parseSchedulePayload(payload, length, index, newItem)) {
+        // Only the changed slot goes over I2C
+        if (rtc.setSchedule(index, newItem)) {
             Serial.printf("Schedule at index %d saved successfully.\n", index);
         } else {
             Serial.println("Failed to save schedules to RTC RAM.");
@@ -259,41 +275,56 @@ void onSetScheduleCallback(const char* payload) {
     }
 }
 
-// It parses the payload for setting a schedule: "index:HH:MM:duration:daysOfWeek:enabled"
-bool parseSchedulePayload(const char* payload, int& index, ScheduleItem& item) {
-    int enabled_int;
-    int parsed = sscanf(payload, "%d:%2hhu:%2hhu:%hu:%hhu:%d", 
-                        &index, &item.hour, &item.minute, 
-                        &item.duration_sec, &item.daysOfWeek, &enabled_int);
-    
-    if (parsed == 6 && index >= 0 && index < MAX_SCHEDULES) {
-        item.enabled = (enabled_int == 1);
-        return true;
-    }
-    return false;
-}
-
 void publishMsg(const char *topic, const char *payload,bool retained){
   if (mqttClient.connected()) {
-      String jsonPayload = "{";
-      jsonPayload += "\"payload\":\"";
-      jsonPayload += payload;
-      jsonPayload += "\",";
-      jsonPayload += "\"timestamp\":\"";
-      jsonPayload += rtc.getCurrentTimestamp();
-      jsonPayload += "\"";
-      jsonPayload += "}";
-
-      mqttClient.publish(topic, jsonPayload.c_str(),retained); // Publish the JSON payload
+      StatusMessage jsonPayload;
+      if (!buildStatusMessage(jsonPayload, payload, rtc.getCurrentTimestamp())) {
+        Serial.printf("Message for %s too long, not sent\n", topic);
+        return;
+      }
+      outbox.publish(topic, jsonPayload.c_str(),retained); // Queue the JSON payload
     }
 }
 
+void flushOutbox() {
+  bool sent = mqttClient.connected() && outbox.flush();
+  if (!sent) {
+    outbox.clear();
+  }
+  if (runSummaryQueued && sent) {
+    runSummaryPending = false;
+  }
+  runSummaryQueued = false;
+}
+
+// One message per pump run. Kept pending until a flush sends it, so a run that ends while MQTT is
+// down, or whose flush fails, is reported on reconnect.
+void publishRunSummary() {
+  if (!runSummaryPending || runSummaryQueued || !mqttClient.connected()) {
+    return;
+  }
+  RunSummaryMessage summary;
+  if (!buildRunSummary(summary, pumpRun, rtc.getCurrentTimestamp())) {
+    Serial.println("Run summary too long, not sent");
+    runSummaryPending = false;  // It will not fit on a later try either
+    return;
+  }
+  runSummaryQueued = outbox.publish(PUMP_RUN_SUMMARY, summary.c_str());
+}
+
 
 void pumpStart(){
-  if (!digitalRead(MOSFET_PIN) && (!firmwareUpdate)) {
+  if (!digitalRead(MOSFET_PIN) && !deviceState.pumpRunning && (!firmwareUpdate)) {
     Serial.println("Starting pump");
     digitalWrite(MOSFET_PIN, HIGH);
     deviceState.pumpRunning = true;
+    // A new run gets a fresh chance, the flags only describe the last run
+    deviceState.waterTankEmpty = false;
+    deviceState.overCurrent = false;
+    pumpGuard.begin(millis());
+    if (inaReady) {
+      currentSampler.start();
+    }
     if (mqttClient.connected()) {
       publishMsg(PUMP_STATUS_TOPIC, "on",true);
     }
@@ -302,12 +333,17 @@ void pumpStart(){
   Serial.println("Pump already in running state or upgrade in progress");
 }
 
-void pumpStop() {
-  if (digitalRead(MOSFET_PIN)) {
+void pumpStop(StopReason reason) {
+  // After a trip the sampler has already cut the MOSFET, the rest of the stop is still due
+  if (digitalRead(MOSFET_PIN) || deviceState.pumpRunning) {
     Serial.println("Stopping pump");
     digitalWrite(MOSFET_PIN, LOW);
     deviceState.pumpRunning = false;
+    currentSampler.stop();
+    pumpRun.end(millis(), reason);
+    runSummaryPending = true;
     publishMsg(PUMP_STATUS_TOPIC, "off",true);
+    publishRunSummary();
 
     // Always recalculate the next alarm when the pump stops.
     // This correctly resumes the schedule after both manual and automatic stops,
@@ -323,12 +359,25 @@ void checkForOTAUpdate() {
   HTTPClient http;
   Serial.println("Checking for OTA updates...");
 
+  // espClient is shared, so the broker connection has to go. The state machine is reset below
+  // and brings it back with the broker session once this returns.
+  flushOutbox();
+  rtc.flushSchedules(true);  // A successful update restarts without returning
+  mqttClient.disconnect();
+  espClient.setSession(&tlsSessions.ota);
+
   String updateURL = String(UPDATEURL) + "?nocache=" + String(millis()); // Force fresh request
   if (http.begin(espClient, updateURL)) { 
     Serial.println("Connected to update server...");
     http.setTimeout(5000); // Set 5-second timeout
 
+    uint32_t requestStarted = millis();
     int httpCode = http.GET(); // Perform GET request to fetch the version file
+    if (espClient.connected()) {
+      bool resumed = tlsSessions.noteHandshake(tlsSessions.ota);
+      Serial.printf("Update host TLS %s, request took %u ms\n", resumed ? "resumed" : "full handshake",
+                    millis() - requestStarted);
+    }
     if (httpCode == HTTP_CODE_OK) {
       String fetchedFirmwareVersionString = http.getString(); // Store the String object
       fetchedFirmwareVersionString.trim(); // Trim whitespace
@@ -365,34 +414,49 @@ void checkForOTAUpdate() {
     Serial.println("Unable to connect to OTA update server.");
   }
   http.end();
+  espClient.setSession(&tlsSessions.mqtt);
+  mqttConnection.reset();  // Reconnect straight away, not through a lost connection and backoff
 }
 
-void connectNetworkStack() {
-  if (WiFi.status() == WL_CONNECTED && mqttClient.connected()) {
-    deviceState.radioStatus = ConnectivityStatus::SERVERCONNECTED;
+const char* subscriptionTopic(size_t index) {
+  return index < sizeof(topicRoutes) / sizeof(topicRoutes[0]) ? topicRoutes[index].topic : nullptr;
+}
+
+// Called from every loop(), each call moves the broker connection on by at most one phase
+void serviceMqttConnection() {
+  if (WiFi.status() != WL_CONNECTED || firmwareUpdateOngoing) {
     return;
   }
+  bool wasConnected = mqttConnection.isConnected();
+  // The TLS handshake and CONNECT block loop() for seconds, while the pump runs they wait up to
+  // MQTT_DEFER_MAX first
+  mqttConnection.step(millis(), !deviceState.pumpRunning);
+  if (!wasConnected && mqttConnection.isConnected()) {
+    bool resumed = tlsSessions.noteHandshake(tlsSessions.mqtt);
+    Serial.printf("Broker TLS %s in %u ms\n", resumed ? "resumed" : "full handshake",
+                  mqttConnection.getPhaseMs(MqttConnection::TLS));
+    deviceState.radioStatus = ConnectivityStatus::SERVERCONNECTED;
+    publishRunSummary();
+  }
+}
 
-  if (WiFi.status() == WL_CONNECTED && !mqttClient.connected()) {
-    if (mqttClient.connect("beegreen", mqttDetails.mqtt_user, mqttDetails.mqtt_password)) {
-      mqttClient.subscribe(PUMP_CONTROL_TOPIC);
-      mqttClient.subscribe(SET_SCHEDULE);
-      mqttClient.subscribe(REQUEST_ALL_SCHEDULES);
-      mqttClient.subscribe(GET_UPDATE_REQUEST);
-      mqttClient.subscribe(RESTART);
-      deviceState.radioStatus = ConnectivityStatus::SERVERCONNECTED;
-      return;
-    }
-    deviceState.radioStatus = ConnectivityStatus::SERVERNOTCONNECTED;
+void connectNetworkStack() {
+  if (WiFi.status() == WL_CONNECTED) {
+    deviceState.radioStatus = mqttConnection.isConnected() ? ConnectivityStatus::SERVERCONNECTED
+                                                           : ConnectivityStatus::SERVERNOTCONNECTED;
     return;
   }
 
+  // Without WiFi the next connection starts from scratch, with no backoff left over
+  mqttConnection.reset();
+
   if (WiFi.status() != WL_CONNECTED && wm.getConfigPortalActive()) {
      deviceState.radioStatus = ConnectivityStatus::LOCALNOTCONNECTED;
      return;
   }
 
   if (WiFi.status() != WL_CONNECTED && !wm.getConfigPortalActive() && !digitalRead(MOSFET_PIN)) {
+     rtc.flushSchedules(true);
      wm.reboot();
   }
 }
@@ -405,26 +469,45 @@ void updateAndPublishNextAlarm() {
     // Get the time that was just set
     DateTime nextAlarm = rtc.getNextDueAlarm();
     
-    char buffer[20];
-    snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d %02d:%02d:%02d",
-             nextAlarm.year(), nextAlarm.month(), nextAlarm.day(),
-             nextAlarm.hour(), nextAlarm.minute(), nextAlarm.second());
+    MessageBuilder<TIMESTAMP_SIZE> timestamp;
+    timestamp.appendTimestamp(nextAlarm);
              
     // Publish the message with the retain flag set to true
-    mqttClient.publish(NEXT_SCHEDULE, buffer, true);
+    outbox.publish(NEXT_SCHEDULE, timestamp.c_str(), true);
   } else {
     // If no alarms are set, publish an empty string to clear the retained message
-    mqttClient.publish(NEXT_SCHEDULE, "", true);
+    outbox.publish(NEXT_SCHEDULE, "", true);
   }
 }
 
-Timer heartBeat(HEARTBEAT_TIMER,Timer::SCHEDULER,[]() {
-    if (mqttClient.connected()) {
-    mqttClient.publish(HEARBEAT_TOPIC, FIRMWARE_VERSION);
+void publishHeartbeat() {
+  if (mqttClient.connected()) {
+    outbox.publish(HEARBEAT_TOPIC, FIRMWARE_VERSION);
   }
-});
+#ifdef DEBUG_STATS
+  Serial.printf("Events: max depth %u, dropped %u, latency avg %u us max %u us\n",
+                events.getHighWater(), events.getDropped(),
+                events.getAverageLatencyUs(), events.getMaxLatencyUs());
+  events.resetStats();
+
+  TimerWheel& wheel = TimerWheel::instance();
+  Serial.printf("Timers: %u ticks, jitter max %u ms, max %u jobs / %u us per tick\n",
+                wheel.getTicks(), wheel.getMaxJitterMs(),
+                wheel.getMaxJobsPerTick(), wheel.getMaxTickMicros());
+  wheel.resetStats();
+
+  Serial.printf("MQTT out: %u packets in %u writes, %u bytes, max %u per write, %u failed\n",
+                outbox.getPackets(), outbox.getWrites(), outbox.getBytes(),
+                outbox.getMaxCoalesced(), outbox.getFailures());
+  outbox.resetStats();
+
+  Serial.printf("MQTT link: %u attempts, %u failed, longest step %u ms\n",
+                mqttConnection.getAttempts(), mqttConnection.getFailures(),
+                mqttConnection.getMaxStepMs());
+#endif
+}
 
-Timer setLedColor(500,Timer::SCHEDULER,[](){
+void updateLed() {
   if (firmwareUpdateOngoing){
     ledColorPicker[0] = LedColor::MAGENTA;
     ledColorPicker[1] = LedColor::OFF;
@@ -454,33 +537,73 @@ Timer setLedColor(500,Timer::SCHEDULER,[](){
   picker = !picker;
   led.setPixelColor(0,ledColorPicker[int(picker)]);
   led.show();
-});
+}
 
-Timer alarmHandler(1000, Timer::SCHEDULER, []() {
-  if (rtc.alarmTriggered(ALARM::ONTRIGGER) && !digitalRead(MOSFET_PIN)) {
+void serviceAlarms() {
+  // One I2C read answers both alarms
+  AlarmStatus alarms = rtc.getAlarmStatus();
+  bool onAlarm = alarms.triggered[ALARM::ONTRIGGER];
+  bool offAlarm = alarms.triggered[ALARM::OFFTRIGGER];
+
+#ifdef RTC_MFP_PIN
+  // MFP stays high while any flag is set, clear what fired so the next alarm gives a new edge
+  if (onAlarm) rtc.clearAlarm(ALARM::ONTRIGGER);
+  if (offAlarm) rtc.clearAlarm(ALARM::OFFTRIGGER);
+#endif
+
+  if (onAlarm && !digitalRead(MOSFET_PIN)) {
     Serial.println("onAlarm triggered: ");
     pumpStart();
   }
 
-  if (rtc.alarmTriggered(ALARM::OFFTRIGGER) && digitalRead(MOSFET_PIN)) {
+  if (offAlarm && digitalRead(MOSFET_PIN)) {
     Serial.println("offAlarm triggered: ");
     // pumpStop now correctly handles stopping the pump AND setting the next alarm.
-    pumpStop();
+    pumpStop(STOP_ALARM);
   }
+}
+
+// The Timers run in Ticker context and only queue work, loop() does it. currentSampler above is
+// the exception, it reads the INA219 itself and yields the bus to loop()'s transfers.
+Timer heartBeat(HEARTBEAT_TIMER,Timer::SCHEDULER,[]() {
+  events.push(DeferredEvent::PUBLISH_HEARTBEAT);
+});
+
+Timer setLedColor(500,Timer::SCHEDULER,[](){
+  events.push(DeferredEvent::UPDATE_LED);
+});
+
+// Polling fallback, only started when the MFP pin is not wired
+Timer alarmHandler(1000, Timer::SCHEDULER, []() {
+  events.push(DeferredEvent::SERVICE_ALARMS);
 });
 
 Timer loopMqtt(5000,Timer::SCHEDULER,[]() {
-  mqttloop = true;
+  events.push(DeferredEvent::CONNECT_NETWORK);
+});
+
+Timer scheduleScrub(SCHEDULE_SCRUB_INTERVAL, Timer::SCHEDULER, []() {
+  events.push(DeferredEvent::SCRUB_SCHEDULES);
+});
+
+#ifdef CURRENT_LIVE_STREAM
+Timer currentConsumption(CURRENT_PUBLISH_INTERVAL, Timer::SCHEDULER,[]() {
+  events.push(DeferredEvent::PUBLISH_CURRENT);
 });
+#endif
+
+// The schedule overflow shares the EEPROM, every begin() must use the same size
+static_assert(EEPROM_START_ADDR + sizeof(MqttCredentials) <= SCHEDULE_EEPROM_ADDR,
+              "MQTT credentials overlap the schedule records in EEPROM");
 
 void eeprom_read() {
-  EEPROM.begin(sizeof(mqttDetails) + 10);
+  EEPROM.begin(EEPROM_SIZE);
   EEPROM.get(EEPROM_START_ADDR, mqttDetails);
   EEPROM.end();
 }
 
 void eeprom_saveconfig() {
-  EEPROM.begin(sizeof(mqttDetails) + 10);
+  EEPROM.begin(EEPROM_SIZE);
   EEPROM.put(EEPROM_START_ADDR, mqttDetails);
   if (EEPROM.commit()){
   EEPROM.end();
@@ -495,23 +618,78 @@ void stopServices() {
   setLedColor.stop();
   alarmHandler.stop();
   loopMqtt.stop();
+  scheduleScrub.stop();
+#ifdef CURRENT_LIVE_STREAM
+  currentConsumption.stop();
+#endif
   // Ensure the pump is stopped
-  pumpStop();
+  pumpStop(STOP_MANUAL);
 }
 
 
-#ifdef INA219_I2C_ADDR
-  Timer currentConsumption(30000, Timer::SCHEDULER,[]() {
-    if (INA.isConnected() && digitalRead(MOSFET_PIN)) {
-      current  = INA.getCurrent_mA();
-      Serial.println(current);
-      if (current !=0){
-         publishMsg(CURRENT_CONSUMPTION, String(current).c_str(),false);
-      }
-    }
-  });
+// Finishes a stop the sampler started by cutting the MOSFET
+void handlePumpTrip() {
+  int mA = (int)(pumpGuard.getLatestCentiMa() / 100);
+  switch (pumpGuard.takeTrip()) {
+    case PumpGuard::Monitor::DRY_RUN:
+      Serial.printf("Pump running dry (%d mA), stopped after %u ms\n", mA, currentMonitor.getTripLatencyMs());
+      deviceState.waterTankEmpty = true;
+      pumpStop(STOP_DRY_RUN);
+      break;
+    case PumpGuard::Monitor::OVER_CURRENT:
+      Serial.printf("Pump over current (%d mA), stopped after %u ms\n", mA, currentMonitor.getTripLatencyMs());
+      deviceState.overCurrent = true;
+      pumpStop(STOP_OVER_CURRENT);
+      break;
+    default:
+      break;
+  }
+}
+
+#ifdef CURRENT_LIVE_STREAM
+void publishCurrent() {
+  if (!digitalRead(MOSFET_PIN)) {
+    return;
+  }
+  CurrentStats stats = currentMonitor.stats();
+  if (stats.samples == 0) {
+    return;
+  }
+  Serial.printf("Current mA: min %d max %d mean %d rms %d\n",
+                (int)(stats.min / 100), (int)(stats.max / 100), (int)(stats.mean / 100), (int)(stats.rms / 100));
+  MessageBuilder<16> value;
+  value.appendFixed(stats.mean, 2);
+  publishMsg(CURRENT_CONSUMPTION, value.c_str(),false);
+}
 #endif
 
+void handleEvent(DeferredEvent event) {
+  switch (event) {
+    case DeferredEvent::PUBLISH_HEARTBEAT:
+      publishHeartbeat();
+      break;
+    case DeferredEvent::UPDATE_LED:
+      updateLed();
+      break;
+    case DeferredEvent::SERVICE_ALARMS:
+      serviceAlarms();
+      break;
+    case DeferredEvent::CONNECT_NETWORK:
+      connectNetworkStack();
+      break;
+    case DeferredEvent::SCRUB_SCHEDULES:
+      rtc.verifySchedules();
+      break;
+#ifdef CURRENT_LIVE_STREAM
+    case DeferredEvent::PUBLISH_CURRENT:
+      publishCurrent();
+      break;
+#endif
+    default:
+      break;
+  }
+}
+
 
 void setup() {
   Serial.begin(115200);
@@ -524,8 +702,8 @@ void setup() {
   }
 
   firmwareUpdate = false;
-  mqttloop = true;
   firmwareUpdateOngoing = false;
+  events.push(DeferredEvent::CONNECT_NETWORK);  // Connect on the first loop()
   pinMode(MOSFET_PIN, OUTPUT);
   digitalWrite(MOSFET_PIN, LOW);
 
@@ -536,6 +714,10 @@ void setup() {
   Wire.begin(SDA_PIN, SCL_PIN);
 
   espClient.setInsecure();
+  if (tlsSessions.restore()) {
+    Serial.println("TLS sessions restored from RTC memory");
+  }
+  espClient.setSession(&tlsSessions.mqtt);
   setupWiFi();
   eeprom_read();
   Serial.print("Local IP: ");
@@ -546,6 +728,10 @@ void setup() {
   Serial.printf("- User: %s\n",mqttDetails.mqtt_user);
   mqttClient.setServer(mqttDetails.mqtt_server, mqttDetails.mqtt_port);
   mqttClient.setCallback(mqttCallback);
+  // PubSubClient keeps its default 256 byte buffer: publishes go through the outbox, so it only
+  // builds the CONNECT (under 100 bytes with the longest credentials) and receives the commands
+  mqttConnection.begin(mqttDetails.mqtt_server, mqttDetails.mqtt_port, "beegreen",
+                       mqttDetails.mqtt_user, mqttDetails.mqtt_password);
 
   pinMode(LED_PIN, OUTPUT);
   led.begin();
@@ -554,18 +740,30 @@ void setup() {
   attachInterrupt(digitalPinToInterrupt(BUTTON_PIN), buttonISR, RISING);
 
   rtc.begin();
+#ifdef RTC_MFP_PIN
+  rtc.setAlarmPolarity(true);
+  pinMode(RTC_MFP_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(RTC_MFP_PIN), rtcAlarmISR, RISING);
+  rtcAlarmPending = digitalRead(RTC_MFP_PIN);  // an alarm may have fired while we were down
+#endif
 
   #ifdef INA219_I2C_ADDR
     if(INA.begin()) {
         INA.setMaxCurrentShunt(MAX_CURRENT, SHUNT);
+        inaReady = true;
+#ifdef CURRENT_LIVE_STREAM
         currentConsumption.start();
+#endif
     } else { Serial.println("INA219: Could not connect. Fix and Reboot"); }
   #endif
 
   heartBeat.start();
   setLedColor.start();
+#ifndef RTC_MFP_PIN
   alarmHandler.start();
+#endif
   loopMqtt.start();
+  scheduleScrub.start();
 }
 
 void loop() {
@@ -580,6 +778,7 @@ void loop() {
       WiFi.begin();
     }
   }
+  serviceMqttConnection();
   mqttClient.loop();
   
  if (clickCount > 0) {
@@ -595,7 +794,7 @@ void loop() {
    if (!digitalRead(MOSFET_PIN)) {
         pumpStart();
       } else {
-        pumpStop();
+        pumpStop(STOP_MANUAL);
       }
 
    // Reset the count immediately so the action doesn't fire again.
@@ -619,11 +818,35 @@ void loop() {
   }
  }
 
-  if(mqttloop) {
-    connectNetworkStack();
-    mqttloop = false;
+#ifdef RTC_MFP_PIN
+  if (rtcAlarmPending) {
+    rtcAlarmPending = false;
+    serviceAlarms();
+    // A flag raised while we were servicing keeps MFP high without a new edge
+    if (digitalRead(RTC_MFP_PIN)) {
+      rtcAlarmPending = true;
+    }
+  }
+#endif
+
+  handlePumpTrip();
+
+  DeferredEvent event;
+  while (events.pop(event)) {
+    handleEvent(event);
+  }
+  // A loop() blocked long enough to fill the queue loses timer events, say so when it happens
+  if (events.getDroppedTotal() != eventsDroppedReported) {
+    Serial.printf("Event queue full, %u timer events dropped\n", events.getDroppedTotal() - eventsDroppedReported);
+    eventsDroppedReported = events.getDroppedTotal();
   }
 
+  // Everything published during this iteration leaves in one write
+  flushOutbox();
+
+  // Schedule edits reach EEPROM in one commit once they settle
+  rtc.flushSchedules();
+
   if ((firmwareUpdate) && (!digitalRead(MOSFET_PIN))) {
     checkForOTAUpdate();
     firmwareUpdate = false;
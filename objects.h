@@ -18,6 +18,7 @@
 #define SET_SCHEDULE "beegreen/set_schedule"
 
 #define CURRENT_CONSUMPTION "beegreen/current_consumption"
+#define PUMP_RUN_SUMMARY "beegreen/pump_run_summary"
 #define GET_UPDATE_REQUEST "beegreen/firmware_upgrade"
 #define REQUEST_ALL_SCHEDULES "beegreen/get_schedules"
 #define GET_ALL_SCHEDULES "beegreen/get_schedules_response"
@@ -34,12 +35,36 @@
 
 //INA219_HDWR_CONFIG
 #define SHUNT 0.01
+#define SHUNT_MILLIOHM 10  // SHUNT in milliohm, for the integer current conversion
 #define MAX_CURRENT 3.4
+#define INA219_REG_SHUNT 0x01
+#define INA219_REG_BUS 0x02
+
+// Pump current monitoring
+#define CURRENT_SAMPLE_INTERVAL 50      // ms between INA219 readings while the pump runs
+// #define CURRENT_LIVE_STREAM           // Also publish the live current while the pump runs
+#define CURRENT_PUBLISH_INTERVAL 30000  // ms between live current readings
+#define CURRENT_WINDOW 32               // Samples in the min/max/mean/RMS window
+#define INRUSH_GRACE_MS 1000            // No cutoff while the motor draws its start-up current
+#define CURRENT_TRIP_SAMPLES 3          // Consecutive out-of-limit samples before the pump is stopped
+
+// RTC alarm delivery: define RTC_MFP_PIN as the GPIO wired to the MCP7940 MFP output to get
+// interrupt driven alarms. Left undefined the alarm flags are polled over I2C once a second.
+// The MFP is open drain and needs an external pull-up (10k to 3.3V), INPUT_PULLUP only takes
+// over once setup() runs. It must not go to a boot strap pin (GPIO0, 2, 15): the MFP holds the
+// line low through a reset and the ESP8266 would not boot from flash. The non-strap GPIOs 12,
+// 13 and 14 are all taken, so with the MFP on GPIO13 the LED moves to GPIO2, whose level at boot
+// the LED data input does not pull down.
+// #define RTC_MFP_PIN 13
 
 // I/O constants
 #define BUTTON_PIN 14
 #define MOSFET_PIN 12  // Drives the pump
+#ifdef RTC_MFP_PIN
+#define LED_PIN 2      // GPIO13 carries the RTC MFP
+#else
 #define LED_PIN 13     // prod will be 13
+#endif
 #define NUM_LEDS 1
 
 // opertational constants
@@ -56,6 +81,8 @@
 #define EEPROM_START_ADDR 0x01 // EEPROM starts after DRD's byte
 
 #define HEARTBEAT_TIMER 30000
+// #define DEBUG_STATS  // Print the event, timer, outbox and MQTT link statistics with each heartbeat
+#define SCHEDULE_SCRUB_INTERVAL 3600000  // Check RTC RAM schedules against the RAM copy hourly
 #define DRD_TIMEOUT 3.0  // 3 second window for double reset
 
 enum ConnectivityStatus {
@@ -65,6 +92,20 @@ enum ConnectivityStatus {
   SERVERNOTCONNECTED,
 };
 
+// Work the Timers hand over to loop(), so Ticker context stays off the network and, apart from
+// the current sampler's INA219 reads (PumpGuard.h), off I2C
+enum DeferredEvent : uint8_t {
+  PUBLISH_HEARTBEAT,
+  UPDATE_LED,
+  SERVICE_ALARMS,
+  CONNECT_NETWORK,
+  SCRUB_SCHEDULES,
+  PUBLISH_CURRENT,
+};
+
+#define EVENT_QUEUE_SIZE 16  // Power of two
+#define MQTT_OUTBOX_SIZE 1024  // Publishes coalesced per loop(), fits the full schedule list
+
 typedef struct {
 char mqtt_server[60] = "";
 uint16_t mqtt_port;
@@ -91,11 +132,13 @@ struct  State {
   ConnectivityStatus radioStatus = ConnectivityStatus::LOCALNOTCONNECTED;
   bool pumpRunning = false;
   bool waterTankEmpty = false;
+  bool overCurrent = false;
 };
 
 struct Hardconfig {
   uint heartbeat = 60;
-  uint motorCutoffThreshold = 200;
+  uint motorCutoffThreshold = 200;   // mA, less means the pump is running dry
+  uint overCurrentThreshold = 3000;  // mA, more means the pump is blocked
   uint aht20ReadInterval= 60;
 };
 
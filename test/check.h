@@ -0,0 +1,48 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+// Minimal assertions for the host tests: a failed CHECK prints where and carries on, the test
+// returns the number of failures from main() through checkResult().
+
+#include <cstdio>
+#include <chrono>
+
+inline int& checkFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                     \
+    do {                                                                     \
+        if (!(condition)) {                                                  \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                    #condition);                                             \
+            checkFailures()++;                                               \
+        }                                                                    \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                    \
+    do {                                                                              \
+        long long a_ = (long long)(actual), e_ = (long long)(expected);               \
+        if (a_ != e_) {                                                               \
+            fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, \
+                    #actual, a_, e_);                                                 \
+            checkFailures()++;                                                        \
+        }                                                                             \
+    } while (0)
+
+inline int checkResult(const char* name) {
+    printf("%s: %s\n", name, checkFailures() ? "FAILED" : "passed");
+    return checkFailures() ? 1 : 0;
+}
+
+// Wall clock nanoseconds per call of fn over `iterations` calls, for the host benchmarks
+template <typename Fn>
+double nanosPerCall(unsigned long iterations, Fn fn) {
+    auto started = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < iterations; ++i) fn(i);
+    std::chrono::duration<double, std::nano> spent = std::chrono::steady_clock::now() - started;
+    return spent.count() / iterations;
+}
+
+#endif // CHECK_H
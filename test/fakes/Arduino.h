@@ -0,0 +1,131 @@
+#ifndef FAKE_ARDUINO_H
+#define FAKE_ARDUINO_H
+
+// Just enough of the ESP8266 Arduino core to build the firmware sources on a Linux host. Time only
+// moves when a test advances it, pins are plain variables and Serial goes to stdout.
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <algorithm>
+
+typedef uint8_t byte;
+typedef unsigned int uint;
+
+#define PROGMEM
+#define PSTR(x) (x)
+#define F(x) (x)
+class __FlashStringHelper;
+#define IRAM_ATTR
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define memcpy_P memcpy
+#define strcpy_P strcpy
+
+#define B111 0x07
+#define B11111000 0xF8
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 1
+#define FALLING 2
+#define CHANGE 3
+
+// Simulated clock in microseconds, tests move it with delay()
+extern uint64_t fakeClockMicros;
+inline uint32_t millis() { return (uint32_t)(fakeClockMicros / 1000); }
+inline uint32_t micros() { return (uint32_t)fakeClockMicros; }
+inline void delay(uint32_t ms) { fakeClockMicros += ms * 1000ULL; }
+inline void delayMicroseconds(uint32_t us) { fakeClockMicros += us; }
+inline void yield() {}
+
+// Output latches of the GPIOs
+extern uint8_t fakePins[32];
+inline int digitalRead(uint8_t pin) { return fakePins[pin & 31]; }
+inline void digitalWrite(uint8_t pin, uint8_t value) { fakePins[pin & 31] = value ? HIGH : LOW; }
+inline void pinMode(uint8_t, uint8_t) {}
+inline int digitalPinToInterrupt(int pin) { return pin; }
+inline void attachInterrupt(int, void (*)(), int) {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+inline long random(long howBig) { return howBig > 0 ? rand() % howBig : 0; }
+inline long random(long howSmall, long howBig) { return howSmall + random(howBig - howSmall); }
+
+class String : public std::string {
+public:
+    String() {}
+    String(const char* text) : std::string(text) {}
+    String(const std::string& text) : std::string(text) {}
+    String(uint32_t value, int) : std::string(std::to_string(value)) {}
+    void trim() {}
+};
+
+class FakeSerial {
+public:
+    bool muted = false;    // Benchmarks mute the driver's log lines
+    bool capture = false;  // Collect the log in output instead of printing it
+    std::string output;
+
+    void begin(unsigned long) {}
+    template <typename T>
+    void print(const T& value) { emit(text(value)); }
+    template <typename T>
+    void println(const T& value) { emit(text(value) + "\n"); }
+    void println() { emit("\n"); }
+    template <typename... Args>
+    void printf(const char* format, Args... args) {
+        char line[256];
+        snprintf(line, sizeof(line), format, args...);
+        emit(line);
+    }
+    void write(const uint8_t* data, size_t length) { emit(std::string((const char*)data, length)); }
+
+private:
+    void emit(const std::string& text) {
+        if (capture) {
+            output += text;
+        } else if (!muted) {
+            fputs(text.c_str(), stdout);
+        }
+    }
+    static std::string text(const char* value) { return value; }
+    static std::string text(const String& value) { return value; }
+    template <typename T>
+    static std::string text(const T& value) { return std::to_string(value); }
+};
+extern FakeSerial Serial;
+
+// The 512 bytes of RTC user memory, addressed in 4-byte blocks like the SDK
+class EspClass {
+public:
+    bool rtcUserMemoryRead(uint32_t offset, uint32_t* data, size_t size) {
+        if (offset * 4 + size > sizeof(rtcMemory)) return false;
+        memcpy(data, rtcMemory + offset * 4, size);
+        return true;
+    }
+
+    bool rtcUserMemoryWrite(uint32_t offset, uint32_t* data, size_t size) {
+        if (offset * 4 + size > sizeof(rtcMemory)) return false;
+        memcpy(rtcMemory + offset * 4, data, size);
+        rtcWrites++;
+        return true;
+    }
+
+    uint8_t rtcMemory[512] = {0};
+    uint32_t rtcWrites = 0;
+};
+extern EspClass ESP;
+
+#endif // FAKE_ARDUINO_H
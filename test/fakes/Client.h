@@ -0,0 +1,29 @@
+#ifndef FAKE_CLIENT_H
+#define FAKE_CLIENT_H
+
+// The part of the Arduino Client interface the firmware headers write through
+
+#include "Arduino.h"
+
+class Client {
+public:
+    virtual ~Client() {}
+    virtual size_t write(const uint8_t* data, size_t length) = 0;
+};
+
+// Collects everything written, optionally accepting fewer bytes than offered
+class RecordingClient : public Client {
+public:
+    size_t write(const uint8_t* data, size_t length) override {
+        writes++;
+        if (length > accept) length = accept;
+        sent.append((const char*)data, length);
+        return length;
+    }
+
+    std::string sent;
+    uint32_t writes = 0;
+    size_t accept = SIZE_MAX;
+};
+
+#endif // FAKE_CLIENT_H
@@ -0,0 +1,78 @@
+#ifndef FAKE_EEPROM_H
+#define FAKE_EEPROM_H
+
+// The ESP8266 EEPROM emulation: begin() copies the flash sector into a RAM buffer, put() and
+// write() only mark it dirty when a byte changes, commit() erases and rewrites the sector if dirty
+// and end() commits before releasing the buffer. flashWrites counts the sector rewrites.
+
+#include "Arduino.h"
+
+class EEPROMClass {
+public:
+    EEPROMClass() { reset(); }
+
+    // Erased flash, as on a new device
+    void reset() {
+        memset(flash, 0xFF, sizeof(flash));
+        memset(buffer, 0xFF, sizeof(buffer));
+        size = 0;
+        dirty = false;
+        flashWrites = 0;
+    }
+
+    void begin(size_t bytes) {
+        size = std::min(bytes, sizeof(flash));
+        memcpy(buffer, flash, size);
+        dirty = false;
+    }
+
+    bool commit() {
+        if (size == 0) return false;
+        if (!dirty) return true;
+        memcpy(flash, buffer, size);
+        flashWrites++;
+        dirty = false;
+        return true;
+    }
+
+    bool end() {
+        bool committed = commit();
+        size = 0;
+        return committed;
+    }
+
+    uint8_t read(int address) { return (size_t)address < size ? buffer[address] : 0; }
+
+    void write(int address, uint8_t value) {
+        if ((size_t)address >= size || buffer[address] == value) return;
+        buffer[address] = value;
+        dirty = true;
+    }
+
+    template <typename T>
+    T& get(int address, T& value) {
+        if (address + sizeof(T) <= size) memcpy(&value, buffer + address, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    const T& put(int address, const T& value) {
+        if (address + sizeof(T) <= size && memcmp(buffer + address, &value, sizeof(T)) != 0) {
+            memcpy(buffer + address, &value, sizeof(T));
+            dirty = true;
+        }
+        return value;
+    }
+
+    uint8_t flash[4096];
+    uint32_t flashWrites;
+
+private:
+    uint8_t buffer[4096];
+    size_t size;
+    bool dirty;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // FAKE_EEPROM_H
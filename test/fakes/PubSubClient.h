@@ -0,0 +1,56 @@
+#ifndef FAKE_PUBSUBCLIENT_H
+#define FAKE_PUBSUBCLIENT_H
+
+// PubSubClient over an already open socket: CONNECT waits the socket timeout for a CONNACK that
+// a stalled broker never sends
+
+#include "Arduino.h"
+#include "WiFiClientSecure.h"
+#include <string>
+#include <vector>
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+class PubSubClient {
+public:
+    explicit PubSubClient(BearSSL::WiFiClientSecure& client) : client(client) {}
+
+    void setSocketTimeout(uint16_t seconds) { socketTimeout = seconds; }
+
+    bool connect(const char*, const char*, const char*) {
+        connects++;
+        if (!client.connected() || brokerStalled) {
+            delay(socketTimeout * 1000UL);
+            mqttState = MQTT_CONNECTION_TIMEOUT;
+            return false;
+        }
+        mqttState = MQTT_CONNECTED;
+        return true;
+    }
+
+    bool subscribe(const char* topic) {
+        if (!connected()) return false;
+        subscriptions.push_back(topic);
+        return true;
+    }
+
+    bool connected() { return mqttState == MQTT_CONNECTED && client.connected(); }
+
+    void disconnect() {
+        mqttState = MQTT_DISCONNECTED;
+        client.stop();
+    }
+
+    int state() const { return mqttState; }
+
+    BearSSL::WiFiClientSecure& client;
+    uint16_t socketTimeout = 15;
+    bool brokerStalled = false;
+    uint32_t connects = 0;
+    int mqttState = MQTT_DISCONNECTED;
+    std::vector<std::string> subscriptions;
+};
+
+#endif // FAKE_PUBSUBCLIENT_H
@@ -0,0 +1,57 @@
+#ifndef FAKE_TICKER_H
+#define FAKE_TICKER_H
+
+// Tickers fire from runTickers(), which advances the simulated clock and calls every callback that
+// came due on the way, the way the SDK runs them between loop() iterations.
+
+#include "Arduino.h"
+
+class Ticker {
+public:
+    Ticker() : callback(nullptr), intervalMs(0), dueMs(0), next(list()) { list() = this; }
+
+    ~Ticker() {
+        for (Ticker** link = &list(); *link; link = &(*link)->next) {
+            if (*link == this) {
+                *link = next;
+                break;
+            }
+        }
+    }
+
+    void attach_ms(uint32_t milliseconds, void (*task)()) {
+        intervalMs = milliseconds;
+        callback = task;
+        dueMs = millis() + milliseconds;
+    }
+
+    void detach() { callback = nullptr; }
+
+    bool active() const { return callback != nullptr; }
+
+    // Advance the clock by `milliseconds` one millisecond at a time, firing due tickers
+    static void runTickers(uint32_t milliseconds) {
+        while (milliseconds--) {
+            delay(1);
+            for (Ticker* ticker = list(); ticker; ticker = ticker->next) {
+                if (ticker->callback && (int32_t)(millis() - ticker->dueMs) >= 0) {
+                    ticker->dueMs += ticker->intervalMs;
+                    ticker->callback();
+                }
+            }
+        }
+    }
+
+private:
+    static Ticker*& list() {
+        static Ticker* head = nullptr;
+        return head;
+    }
+
+    void (*callback)();
+    uint32_t intervalMs;
+    uint32_t dueMs;
+    Ticker* next;
+};
+
+#endif // FAKE_TICKER_H
@@ -0,0 +1,58 @@
+#ifndef FAKE_WIFICLIENTSECURE_H
+#define FAKE_WIFICLIENTSECURE_H
+
+// BearSSL client whose connect() blocks the simulated clock for stallMs and then succeeds or not.
+// A handshake resumes the session it was given if the server still knows it, otherwise it is a
+// full handshake that fills the session with new parameters.
+
+#include "Arduino.h"
+#include "Client.h"
+
+namespace BearSSL {
+
+// Stands in for br_ssl_session_parameters: session ID, version, cipher suite and master secret
+class Session {
+public:
+    Session() { memset(parameters, 0, sizeof(parameters)); }
+    uint8_t parameters[88];
+};
+
+class WiFiClientSecure : public RecordingClient {
+public:
+    void setSession(Session* resume) { session = resume; }
+
+    void setTimeout(uint32_t milliseconds) { timeoutMs = milliseconds; }
+
+    int connect(const char*, uint16_t) {
+        connects++;
+        delay(stallMs < timeoutMs ? stallMs : timeoutMs);
+        open = accepting && stallMs < timeoutMs;
+        if (open && session) {
+            resumed = serverKnowsSession && session->parameters[0] != 0;
+            if (!resumed) {
+                fullHandshakes++;
+                memset(session->parameters, 0, sizeof(session->parameters));
+                session->parameters[0] = (uint8_t)fullHandshakes;
+                session->parameters[1] = 0xA5;
+            }
+        }
+        return open;
+    }
+
+    void stop() { open = false; }
+    uint8_t connected() { return open; }
+
+    uint32_t connects = 0;
+    uint32_t stallMs = 0;
+    uint32_t timeoutMs = 0;
+    bool accepting = true;
+    bool open = false;
+    Session* session = nullptr;
+    bool serverKnowsSession = true;
+    bool resumed = false;
+    uint32_t fullHandshakes = 0;
+};
+
+}  // namespace BearSSL
+
+#endif // FAKE_WIFICLIENTSECURE_H
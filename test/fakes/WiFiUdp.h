@@ -0,0 +1,6 @@
+#ifndef FAKE_WIFIUDP_H
+#define FAKE_WIFIUDP_H
+
+class WiFiUDP {};
+
+#endif // FAKE_WIFIUDP_H
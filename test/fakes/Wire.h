@@ -0,0 +1,350 @@
+#ifndef FAKE_WIRE_H
+#define FAKE_WIRE_H
+
+// Simulated I2C bus for the host tests. TwoWire routes transfers to register models attached at
+// their addresses and counts every transfer and byte, so a test can state the bus cost of a
+// driver call. BUFFER_LENGTH is the ESP8266 core value unless a test builds with a smaller one.
+
+#include "Arduino.h"
+
+#ifndef BUFFER_LENGTH
+#define BUFFER_LENGTH 128
+#endif
+
+class FakeI2CDevice {
+public:
+    virtual ~FakeI2CDevice() {}
+    // One write transfer, the first byte is the register address
+    virtual void receive(const uint8_t* data, size_t length) = 0;
+    // Next byte of a read transfer
+    virtual uint8_t send() = 0;
+};
+
+class TwoWire {
+public:
+    TwoWire();
+
+    void begin() {}
+    void begin(int, int) {}
+    void setClock(uint32_t) {}
+
+    void attach(uint8_t address, FakeI2CDevice* device) { devices[address & 0x7F] = device; }
+
+    void beginTransmission(uint8_t address) {
+        txAddress = address & 0x7F;
+        txLength = 0;
+    }
+
+    // Like the core, bytes past the buffer are dropped and the write reports 0
+    size_t write(uint8_t data) {
+        if (txLength >= BUFFER_LENGTH) return 0;
+        txBuffer[txLength++] = data;
+        return 1;
+    }
+
+    size_t write(const uint8_t* data, size_t length) {
+        size_t written = 0;
+        while (written < length && write(data[written])) written++;
+        return written;
+    }
+
+    uint8_t endTransmission(bool = true) {
+        transactions++;
+        bytes += txLength;
+        if (txLength > 0) writes[writeCount++ % WRITE_LOG] = {txAddress, txBuffer[0], (uint8_t)(txLength - 1)};
+        if (injectedFailure()) return 4;
+        FakeI2CDevice* device = devices[txAddress];
+        if (!device) return 2;  // Address NACK
+        device->receive(txBuffer, txLength);
+        return 0;
+    }
+
+    // The core clamps a request to the buffer
+    uint8_t requestFrom(uint8_t address, uint8_t quantity) {
+        transactions++;
+        rxLength = rxPosition = 0;
+        if (quantity > BUFFER_LENGTH) quantity = BUFFER_LENGTH;
+        FakeI2CDevice* device = devices[address & 0x7F];
+        if (injectedFailure() || !device) return 0;
+        while (rxLength < quantity) rxBuffer[rxLength++] = device->send();
+        bytes += rxLength;
+        return rxLength;
+    }
+
+    int available() { return rxLength - rxPosition; }
+    int read() { return rxPosition < rxLength ? rxBuffer[rxPosition++] : -1; }
+
+    // Make the transfer after the next `transfers` ones fail, 0 fails the next one
+    void failTransfer(uint32_t transfers) { failCountdown = (int32_t)transfers; }
+
+    void resetStats() {
+        transactions = 0;
+        bytes = 0;
+        writeCount = 0;
+    }
+
+    // Device, register and data length of the last WRITE_LOG write transfers
+    struct Write {
+        uint8_t device;
+        uint8_t reg;
+        uint8_t length;
+    };
+    static const uint32_t WRITE_LOG = 32;
+
+    uint32_t transactions;  // START..STOP sequences on the bus
+    uint32_t bytes;         // Data bytes moved, register addresses included
+    Write writes[WRITE_LOG];
+    uint32_t writeCount;
+
+private:
+    bool injectedFailure() {
+        if (failCountdown < 0) return false;
+        return failCountdown-- == 0;
+    }
+
+    FakeI2CDevice* devices[128];
+    uint8_t txAddress;
+    uint8_t txBuffer[BUFFER_LENGTH];
+    size_t txLength;
+    uint8_t rxBuffer[BUFFER_LENGTH];
+    size_t rxLength;
+    size_t rxPosition;
+    int32_t failCountdown;
+};
+
+extern TwoWire Wire;
+
+// Register model of the MCP7940N: the 0x00-0x1F timekeeping, alarm and power-fail registers and
+// the 64 bytes of SRAM at 0x20-0x5F, each block with its own address pointer wrap. Time is BCD
+// and only advances while ST is set, OSCRUN follows ST, LPYR, OSCRUN and the ALMPOL copy in
+// ALM1WKDAY are read only and PWRFAIL can only be cleared. tick() runs the clock and raises
+// ALMxIF when an enabled alarm matches under its ALMxMSK setting.
+class FakeMCP7940 : public FakeI2CDevice {
+public:
+    static const uint8_t ADDRESS = 0x6F;
+
+    FakeMCP7940() { reset(); }
+
+    void reset() {
+        memset(reg, 0, sizeof(reg));
+        reg[RTCWKDAY] = 1;
+        reg[RTCDATE] = 1;
+        reg[RTCMTH] = 1;
+        pointer = 0;
+    }
+
+    void receive(const uint8_t* data, size_t length) override {
+        if (length == 0) return;  // Address probe
+        pointer = data[0];
+        for (size_t i = 1; i < length; ++i) {
+            writeRegister(pointer, data[i]);
+            advance();
+        }
+    }
+
+    uint8_t send() override {
+        uint8_t value = pointer < sizeof(reg) ? reg[pointer] : 0;
+        advance();
+        return value;
+    }
+
+    // Load a running clock, dayOfWeek is 1-7 as the driver keeps it
+    void setTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second,
+                 uint8_t dayOfWeek) {
+        reg[RTCSEC] = bcd(second) | 0x80;
+        reg[RTCMIN] = bcd(minute);
+        reg[RTCHOUR] = bcd(hour);
+        reg[RTCWKDAY] = (reg[RTCWKDAY] & 0xD8) | 0x20 | (dayOfWeek & 0x07);
+        reg[RTCDATE] = bcd(day);
+        reg[RTCMTH] = bcd(month) | (leapYear(year % 100) ? 0x20 : 0);
+        reg[RTCYEAR] = bcd(year % 100);
+    }
+
+    // Advance a running clock second by second, checking both alarms after every step
+    void tick(uint32_t seconds) {
+        while (seconds-- && (reg[RTCSEC] & 0x80)) {
+            stepSecond();
+            checkAlarm(0);
+            checkAlarm(1);
+        }
+    }
+
+    // Level of the MFP output in alarm or general purpose mode
+    bool mfp() const {
+        uint8_t control = reg[CONTROL];
+        bool enabled0 = control & 0x10;
+        bool enabled1 = control & 0x20;
+        if (!enabled0 && !enabled1) return control & 0x80;
+        bool polarity = reg[ALM0WKDAY] & 0x80;
+        bool fired0 = enabled0 && (reg[ALM0WKDAY] & 0x08);
+        bool fired1 = enabled1 && (reg[ALM1WKDAY] & 0x08);
+        if (enabled0 && enabled1) return polarity ? (fired0 || fired1) : !(fired0 && fired1);
+        bool fired = enabled0 ? fired0 : fired1;
+        return polarity ? fired : !fired;
+    }
+
+    // Flag a power failure the way the device does when VCC returns
+    void powerFail() { reg[RTCWKDAY] |= 0x10; }
+
+    static uint8_t bcd(uint8_t value) { return (value / 10) << 4 | value % 10; }
+    static uint8_t bin(uint8_t value) { return (value >> 4) * 10 + (value & 0x0F); }
+
+    static const uint8_t RTCSEC = 0x00, RTCMIN = 0x01, RTCHOUR = 0x02, RTCWKDAY = 0x03, RTCDATE = 0x04,
+                         RTCMTH = 0x05, RTCYEAR = 0x06, CONTROL = 0x07, ALM0SEC = 0x0A, ALM0WKDAY = 0x0D,
+                         ALM1SEC = 0x11, ALM1WKDAY = 0x14, SRAM = 0x20;
+
+    uint8_t reg[0x60];
+    uint8_t pointer;
+
+private:
+    // The pointer wraps inside the register block and inside the SRAM
+    void advance() {
+        if (pointer == 0x1F) {
+            pointer = 0x00;
+        } else if (pointer == 0x5F) {
+            pointer = SRAM;
+        } else {
+            pointer++;
+        }
+    }
+
+    void writeRegister(uint8_t address, uint8_t value) {
+        switch (address) {
+            case RTCSEC:
+                reg[RTCSEC] = value;
+                reg[RTCWKDAY] = (reg[RTCWKDAY] & ~0x20) | ((value & 0x80) ? 0x20 : 0);  // OSCRUN follows ST
+                break;
+            case RTCWKDAY:
+                // OSCRUN is read only, PWRFAIL can only be cleared
+                reg[RTCWKDAY] = (value & 0x0F) | (reg[RTCWKDAY] & 0x20) | (reg[RTCWKDAY] & value & 0x10);
+                break;
+            case RTCMTH:
+                reg[RTCMTH] = (value & 0x1F) | (reg[RTCMTH] & 0x20);
+                break;
+            case ALM0WKDAY:
+                reg[ALM0WKDAY] = value;
+                reg[ALM1WKDAY] = (reg[ALM1WKDAY] & 0x7F) | (value & 0x80);
+                break;
+            case ALM1WKDAY:
+                reg[ALM1WKDAY] = (value & 0x7F) | (reg[ALM0WKDAY] & 0x80);
+                break;
+            default:
+                if (address < sizeof(reg) && address != 0x09 && address != 0x10 && address != 0x17) {
+                    reg[address] = value;
+                }
+                break;
+        }
+    }
+
+    static bool leapYear(uint8_t year) { return year % 4 == 0; }
+
+    uint8_t daysInMonth() const {
+        static const uint8_t days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        uint8_t month = bin(reg[RTCMTH] & 0x1F);
+        if (month == 2 && leapYear(bin(reg[RTCYEAR]))) return 29;
+        return days[(month + 11) % 12];
+    }
+
+    void stepSecond() {
+        uint8_t second = bin(reg[RTCSEC] & 0x7F) + 1;
+        if (second < 60) {
+            reg[RTCSEC] = bcd(second) | 0x80;
+            return;
+        }
+        reg[RTCSEC] = 0x80;
+        uint8_t minute = bin(reg[RTCMIN] & 0x7F) + 1;
+        if (minute < 60) {
+            reg[RTCMIN] = bcd(minute);
+            return;
+        }
+        reg[RTCMIN] = 0;
+        uint8_t hour = bin(reg[RTCHOUR] & 0x3F) + 1;
+        if (hour < 24) {
+            reg[RTCHOUR] = bcd(hour);
+            return;
+        }
+        reg[RTCHOUR] = 0;
+        uint8_t weekday = (reg[RTCWKDAY] & 0x07) % 7 + 1;
+        reg[RTCWKDAY] = (reg[RTCWKDAY] & 0xF8) | weekday;
+        uint8_t day = bin(reg[RTCDATE] & 0x3F) + 1;
+        if (day <= daysInMonth()) {
+            reg[RTCDATE] = bcd(day);
+            return;
+        }
+        reg[RTCDATE] = 1;
+        uint8_t month = bin(reg[RTCMTH] & 0x1F) + 1;
+        uint8_t year = bin(reg[RTCYEAR]);
+        if (month > 12) {
+            month = 1;
+            year = (year + 1) % 100;
+            reg[RTCYEAR] = bcd(year);
+        }
+        reg[RTCMTH] = bcd(month) | (leapYear(year) ? 0x20 : 0);
+    }
+
+    void checkAlarm(uint8_t alarm) {
+        if (!(reg[CONTROL] & (alarm ? 0x20 : 0x10))) return;
+        const uint8_t* match = reg + (alarm ? ALM1SEC : ALM0SEC);
+        uint8_t mask = (match[3] >> 4) & 0x07;
+        bool second = (reg[RTCSEC] & 0x7F) == (match[0] & 0x7F);
+        bool minute = (reg[RTCMIN] & 0x7F) == (match[1] & 0x7F);
+        bool hour = (reg[RTCHOUR] & 0x3F) == (match[2] & 0x3F);
+        bool weekday = (reg[RTCWKDAY] & 0x07) == (match[3] & 0x07);
+        bool date = (reg[RTCDATE] & 0x3F) == (match[4] & 0x3F);
+        bool month = (reg[RTCMTH] & 0x1F) == (match[5] & 0x1F);
+        bool startOfMinute = (reg[RTCSEC] & 0x7F) == 0;
+        bool startOfHour = startOfMinute && reg[RTCMIN] == 0;
+        bool startOfDay = startOfHour && reg[RTCHOUR] == 0;
+        // Masks other than seconds match for a whole minute, hour or day, the flag is raised
+        // when the match begins
+        bool fired;
+        switch (mask) {
+            case 0: fired = second; break;
+            case 1: fired = minute && startOfMinute; break;
+            case 2: fired = hour && startOfHour; break;
+            case 3: fired = weekday && startOfDay; break;
+            case 4: fired = date && startOfDay; break;
+            case 7: fired = second && minute && hour && weekday && date && month; break;
+            default: fired = false; break;
+        }
+        if (fired) reg[alarm ? ALM1WKDAY : ALM0WKDAY] |= 0x08;
+    }
+};
+
+extern FakeMCP7940 fakeRtc;
+
+// INA219 register model: a pointer write selects one of the 16-bit registers, reads return it
+// MSB first. Tests load the shunt and bus registers from a simulated current source.
+class FakeINA219 : public FakeI2CDevice {
+public:
+    static const uint8_t ADDRESS = 0x40;
+
+    FakeINA219() : pointer(0), lowByte(false) { memset(reg, 0, sizeof(reg)); }
+
+    void receive(const uint8_t* data, size_t length) override {
+        if (length == 0) return;
+        pointer = data[0] % 6;
+        lowByte = false;
+        if (length >= 3) reg[pointer] = (uint16_t)data[1] << 8 | data[2];
+    }
+
+    uint8_t send() override {
+        uint8_t value = lowByte ? reg[pointer] & 0xFF : reg[pointer] >> 8;
+        lowByte = !lowByte;
+        return value;
+    }
+
+    // Shunt register for a current through the given shunt, 10 uV per bit
+    void setCurrentMa(int32_t milliamps, int32_t shuntMilliohm) {
+        reg[1] = (uint16_t)(int16_t)(milliamps * shuntMilliohm / 10);
+    }
+
+    // Bus register, 4 mV per bit in bits 15..3
+    void setBusMillivolts(uint32_t millivolts) { reg[2] = (uint16_t)(millivolts / 4) << 3; }
+
+    uint16_t reg[6];
+    uint8_t pointer;
+    bool lowByte;
+};
+
+#endif // FAKE_WIRE_H
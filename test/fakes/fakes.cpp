@@ -0,0 +1,21 @@
+// Globals of the fake Arduino core, shared by every host test
+#include "Arduino.h"
+#include "Wire.h"
+#include "EEPROM.h"
+#include "lwip/dns.h"
+
+uint64_t fakeClockMicros = 0;
+uint8_t fakePins[32] = {0};
+uint32_t fakeNtpEpoch = 0;
+FakeSerial Serial;
+EspClass ESP;
+FakeMCP7940 fakeRtc;
+EEPROMClass EEPROM;
+TwoWire Wire;
+FakeDns fakeDns;
+
+TwoWire::TwoWire()
+    : transactions(0), bytes(0), writeCount(0), txAddress(0), txLength(0), rxLength(0), rxPosition(0), failCountdown(-1) {
+    memset(devices, 0, sizeof(devices));
+    attach(FakeMCP7940::ADDRESS, &fakeRtc);
+}
@@ -0,0 +1,49 @@
+#ifndef FAKE_LWIP_DNS_H
+#define FAKE_LWIP_DNS_H
+
+// lwIP's asynchronous lookup: a cached name answers at once, otherwise the answer comes through
+// the callback when the test calls fakeDns.answer()
+
+#include "Arduino.h"
+
+typedef int8_t err_t;
+#define ERR_OK 0
+#define ERR_INPROGRESS -5
+#define ERR_ARG -16
+
+struct ip_addr_t {
+    uint32_t addr;
+};
+
+typedef void (*dns_found_callback)(const char* name, const ip_addr_t* address, void* arg);
+
+struct FakeDns {
+    bool cached = true;
+    uint32_t lookups = 0;
+    dns_found_callback pending = nullptr;
+    void* pendingArg = nullptr;
+
+    // Deliver the outstanding answer, nullptr address for a failed lookup
+    void answer(bool found) {
+        if (!pending) return;
+        ip_addr_t address = {0x0100007F};
+        dns_found_callback callback = pending;
+        pending = nullptr;
+        callback("broker", found ? &address : nullptr, pendingArg);
+    }
+};
+
+extern FakeDns fakeDns;
+
+inline err_t dns_gethostbyname(const char*, ip_addr_t* address, dns_found_callback found, void* arg) {
+    fakeDns.lookups++;
+    if (fakeDns.cached) {
+        address->addr = 0x0100007F;
+        return ERR_OK;
+    }
+    fakeDns.pending = found;
+    fakeDns.pendingArg = arg;
+    return ERR_INPROGRESS;
+}
+
+#endif // FAKE_LWIP_DNS_H
@@ -0,0 +1,97 @@
+// setAlarm() loads ALMxSEC..ALMxMTH in one auto-incrementing write and the enable bit in the same
+// batch. It used to take a clear, a read and six single register writes plus a read-modify-write
+// of CONTROL, about 11 transfers per alarm.
+#include "check.h"
+#include "MCP7940_Scheduler.h"
+#include <EEPROM.h>
+
+static MCP7940_Class& startedRtc() {
+    static MCP7940_Class rtc;
+    fakeRtc.reset();
+    rtc.begin();
+    rtc.adjust(DateTime(2025, 7, 2, 21, 14, 3));
+    return rtc;
+}
+
+static void blockWrite() {
+    for (uint8_t alarm = 0; alarm < 2; ++alarm) {
+        MCP7940_Class& rtc = startedRtc();
+        rtc.setAlarmPolarity(true);
+        uint8_t offset = alarm * 7;
+
+        Wire.resetStats();
+        CHECK(rtc.setAlarm(alarm, 7, DateTime(2025, 7, 2, 21, 30, 45)));
+        CHECK_EQ(Wire.transactions, 4);
+
+        // One 6 byte write for the bank, then CONTROL
+        uint32_t bankWrites = 0;
+        for (uint32_t i = 0; i < Wire.writeCount; ++i) {
+            const TwoWire::Write& write = Wire.writes[i];
+            if (write.reg == MCP7940_ALM0SEC + offset) {
+                CHECK_EQ(write.length, 6);
+                bankWrites++;
+            } else {
+                CHECK(write.length == 0 || write.reg == MCP7940_CONTROL);
+            }
+        }
+        CHECK_EQ(bankWrites, 1);
+
+        const uint8_t* bank = fakeRtc.reg + MCP7940_ALM0SEC + offset;
+        CHECK_EQ(bank[0], 0x45);
+        CHECK_EQ(bank[1], 0x30);
+        CHECK_EQ(bank[2], 0x21);
+        CHECK_EQ((bank[3] >> 4) & 0x07, 7);
+        CHECK_EQ(bank[3] & 0x07, DateTime(2025, 7, 2).dayOfTheWeek());
+        CHECK_EQ(bank[3] & 0x80, 0x80);  // ALMPOL kept
+        CHECK_EQ(bank[4], 0x02);
+        CHECK_EQ(bank[5], 0x07);
+        CHECK(rtc.getAlarmState(alarm));
+    }
+}
+
+static void failedWriteRestores() {
+    MCP7940_Class& rtc = startedRtc();
+    CHECK(rtc.setAlarm(0, 7, DateTime(2025, 7, 2, 21, 30, 0)));
+    uint8_t before[0x17];
+    memcpy(before, fakeRtc.reg, sizeof(before));
+
+    // Read, disable the running alarm, then the bank write fails
+    Wire.failTransfer(3);
+    CHECK(!rtc.setAlarm(0, 7, DateTime(2025, 7, 3, 6, 0, 0)));
+    CHECK(memcmp(before + MCP7940_ALM0SEC, fakeRtc.reg + MCP7940_ALM0SEC, 6) == 0);
+    CHECK_EQ(fakeRtc.reg[MCP7940_CONTROL], before[MCP7940_CONTROL]);
+}
+
+static void schedulerCalls() {
+    fakeRtc.reset();
+    EEPROM.reset();
+    Serial.muted = true;
+    MCP7940Scheduler scheduler;
+    scheduler.begin();
+    fakeRtc.setTime(2025, 7, 2, 21, 14, 3, 3);
+    WateringSchedules schedules{};
+    schedules.items[0] = {21, 30, 60, DOW_EVERYDAY, true};
+    scheduler.setSchedules(schedules);
+
+    // Both alarms in one batch, plus the clock read
+    Wire.resetStats();
+    CHECK(scheduler.setNextAlarm());
+    CHECK_EQ(Wire.transactions, 7);
+    Wire.resetStats();
+    CHECK(scheduler.setManualStopTime(300));
+    CHECK_EQ(Wire.transactions, 7);
+    Serial.muted = false;
+
+    DateTime on, off;
+    scheduler.getAlarms(on, off);
+    CHECK_EQ(off.hour(), 21);
+    CHECK_EQ(off.minute(), 19);
+    CHECK_EQ(off.second(), 3);
+}
+
+int main() {
+    blockWrite();
+    failedWriteRestores();
+    schedulerCalls();
+    return checkResult("alarm_block_write");
+}
@@ -0,0 +1,84 @@
+// I2C transfers per simulated day with the alarm flags polled every second and with the MFP pin
+// raising an interrupt, following serviceAlarms() in the sketch. Both modes must start and stop
+// the pump on the same seconds.
+#include "check.h"
+#include "MCP7940_Scheduler.h"
+#include <EEPROM.h>
+
+struct DayResult {
+    uint32_t transfers;
+    uint32_t pumpOnAt[2];
+    uint32_t pumpOffAt[2];
+    uint8_t runs;
+};
+
+static DayResult simulateDay(bool interruptDriven) {
+    fakeRtc.reset();
+    EEPROM.reset();
+    Serial.muted = true;
+    MCP7940Scheduler rtc;
+    rtc.begin();
+    if (interruptDriven) rtc.setAlarmPolarity(true);
+    fakeRtc.setTime(2025, 7, 2, 0, 0, 0, 3);
+    WateringSchedules schedules{};
+    schedules.items[0] = {6, 0, 60, DOW_EVERYDAY, true};
+    schedules.items[1] = {18, 30, 120, DOW_EVERYDAY, true};
+    rtc.setSchedules(schedules);
+    rtc.setNextAlarm();
+
+    DayResult result = {0, {0, 0}, {0, 0}, 0};
+    bool pumpRunning = false;
+    bool mfpLevel = fakeRtc.mfp();
+    uint32_t started = Wire.transactions;
+    for (uint32_t second = 1; second <= 86400; ++second) {
+        fakeRtc.tick(1);
+        bool service = true;
+        if (interruptDriven) {
+            // RISING edge on the pin, or a level still high after the last service
+            bool level = fakeRtc.mfp();
+            service = level && !mfpLevel;
+            mfpLevel = level;
+        }
+        while (service) {
+            AlarmStatus alarms = rtc.getAlarmStatus();
+            bool onAlarm = alarms.triggered[ALARM::ONTRIGGER];
+            bool offAlarm = alarms.triggered[ALARM::OFFTRIGGER];
+            if (interruptDriven) {
+                if (onAlarm) rtc.clearAlarm(ALARM::ONTRIGGER);
+                if (offAlarm) rtc.clearAlarm(ALARM::OFFTRIGGER);
+            }
+            if (onAlarm && !pumpRunning && result.runs < 2) {
+                pumpRunning = true;
+                result.pumpOnAt[result.runs] = second;
+            }
+            if (offAlarm && pumpRunning) {
+                pumpRunning = false;
+                result.pumpOffAt[result.runs++] = second;
+                rtc.setNextAlarm();
+            }
+            service = interruptDriven && fakeRtc.mfp();
+            mfpLevel = fakeRtc.mfp();
+        }
+    }
+    result.transfers = Wire.transactions - started;
+    Serial.muted = false;
+    return result;
+}
+
+int main() {
+    DayResult polled = simulateDay(false);
+    DayResult interrupt = simulateDay(true);
+    printf("I2C transfers per day: polled %u, MFP interrupt %u\n", polled.transfers, interrupt.transfers);
+
+    for (const DayResult& day : {polled, interrupt}) {
+        CHECK_EQ(day.runs, 2);
+        CHECK_EQ(day.pumpOnAt[0], 6 * 3600);
+        CHECK_EQ(day.pumpOffAt[0], 6 * 3600 + 60);
+        CHECK_EQ(day.pumpOnAt[1], 18 * 3600 + 30 * 60);
+        CHECK_EQ(day.pumpOffAt[1], 18 * 3600 + 30 * 60 + 120);
+    }
+    // Polling reads the flags every second, the interrupt only once per alarm
+    CHECK(polled.transfers >= 2 * 86400);
+    CHECK_EQ(interrupt.transfers, 44);
+    return checkResult("alarm_delivery");
+}
@@ -0,0 +1,148 @@
+// The loop-free DateTime conversions against the loop versions they replaced, for every day the
+// 32 bit Unix time can hold from 2000 on, followed by a benchmark of both. The numbers measured on
+// the development host are kept in benchmarks.md.
+#include "check.h"
+#include "MCP7940.h"
+#include <ctime>
+
+static const uint8_t referenceMonthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+// date2days() as it was: one step per month
+static uint16_t referenceDays(uint16_t y, uint8_t m, uint8_t d) {
+    if (y >= 2000) y -= 2000;
+    uint16_t days = d;
+    for (uint8_t i = 1; i < m; ++i) days += referenceMonthDays[i - 1];
+    if (m > 2 && y % 4 == 0) ++days;
+    if (((y % 100) == 0) && ((y % 400) != 0)) --days;
+    return days + 365 * y + (y + 3) / 4 - 1;
+}
+
+struct Civil {
+    uint16_t year;
+    uint8_t month, day, hour, minute, second;
+};
+
+// DateTime(uint32_t) as it was: one step per year and per month, with every fourth year a leap
+// year, which is only right until 2099
+static Civil referenceCivil(uint32_t t) {
+    Civil civil;
+    t -= SECS_1970_TO_2000;
+    civil.second = t % 60;
+    t /= 60;
+    civil.minute = t % 60;
+    t /= 60;
+    civil.hour = t % 24;
+    uint16_t days = t / 24;
+    uint8_t leap, yOff;
+    for (yOff = 0;; ++yOff) {
+        leap = yOff % 4 == 0;
+        if (days < (uint16_t)365 + leap) break;
+        days -= 365 + leap;
+    }
+    uint8_t month;
+    for (month = 1;; ++month) {
+        uint8_t monthDays = referenceMonthDays[month - 1];
+        if (leap && month == 2) ++monthDays;
+        if (days < monthDays) break;
+        days -= monthDays;
+    }
+    civil.year = 2000 + yOff;
+    civil.month = month;
+    civil.day = days + 1;
+    return civil;
+}
+
+static uint8_t referenceDayOfTheWeek(uint16_t y, uint8_t m, uint8_t d) {
+    uint8_t dow = (referenceDays(y, m, d) + 6) % 7;
+    return dow == 0 ? 7 : dow;
+}
+
+// Every day from 2000-01-01 to 2106-02-06, at a time of day that moves through the seconds
+static void everyDay() {
+    const uint32_t lastDay = (UINT32_MAX - SECS_1970_TO_2000) / 86400 - 1;  // The last whole day
+    uint32_t checked = 0;
+    for (uint32_t day = 0; day <= lastDay; ++day) {
+        uint32_t seconds = SECS_1970_TO_2000 + day * 86400 + (day * 7919) % 86400;
+        time_t host = seconds;
+        struct tm utc;
+        gmtime_r(&host, &utc);
+
+        DateTime fromUnix(seconds);
+        CHECK_EQ(fromUnix.year(), utc.tm_year + 1900);
+        CHECK_EQ(fromUnix.month(), utc.tm_mon + 1);
+        CHECK_EQ(fromUnix.day(), utc.tm_mday);
+        CHECK_EQ(fromUnix.hour(), utc.tm_hour);
+        CHECK_EQ(fromUnix.minute(), utc.tm_min);
+        CHECK_EQ(fromUnix.second(), utc.tm_sec);
+        CHECK_EQ(fromUnix.dayOfTheWeek(), utc.tm_wday == 0 ? 7 : utc.tm_wday);
+
+        DateTime fromCivil(utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec);
+        CHECK_EQ(fromCivil.unixtime(), seconds);
+        CHECK_EQ((fromCivil + TimeSpan(86400)).unixtime(), (uint32_t)(seconds + 86400));
+
+        if (fromUnix.year() < 2100) {
+            Civil old = referenceCivil(seconds);
+            CHECK_EQ(fromUnix.year(), old.year);
+            CHECK_EQ(fromUnix.month(), old.month);
+            CHECK_EQ(fromUnix.day(), old.day);
+            CHECK_EQ(fromUnix.second(), old.second);
+            CHECK_EQ(fromCivil.dayOfTheWeek(), referenceDayOfTheWeek(old.year, old.month, old.day));
+            CHECK_EQ((fromCivil.unixtime() - SECS_1970_TO_2000) / 86400,
+                     referenceDays(old.year, old.month, old.day));
+        }
+        if (checkFailures()) break;  // One bad day is enough to read
+        checked++;
+    }
+    CHECK_EQ(checked, lastDay + 1);
+    CHECK_EQ(DateTime(0).unixtime(), 0);  // The scheduler's empty alarm
+}
+
+// Same inputs for both versions: dates spread over the century, converted in a loop
+static void benchmark() {
+    const unsigned long iterations = 4000000;
+    const uint32_t samples = 1024;
+    static uint32_t times[samples];
+    static DateTime dates[samples];
+    static Civil civils[samples];
+    for (uint32_t i = 0; i < samples; ++i) {
+        times[i] = SECS_1970_TO_2000 + (uint32_t)(((uint64_t)i * 3063853979UL) % (99ULL * 365 * 86400));
+        dates[i] = DateTime(times[i]);
+        civils[i] = referenceCivil(times[i]);
+    }
+    volatile uint32_t sink = 0;
+
+    double construct = nanosPerCall(iterations, [&](unsigned long i) { sink += DateTime(times[i % samples]).day(); });
+    double constructOld = nanosPerCall(iterations, [&](unsigned long i) { sink += referenceCivil(times[i % samples]).day; });
+    double unixTime = nanosPerCall(iterations, [&](unsigned long i) { sink += dates[i % samples].unixtime(); });
+    double unixOld = nanosPerCall(iterations, [&](unsigned long i) {
+        const Civil& c = civils[i % samples];
+        sink += SECS_1970_TO_2000 + referenceDays(c.year, c.month, c.day) * 86400UL + c.hour * 3600UL + c.minute * 60 + c.second;
+    });
+    double weekday = nanosPerCall(iterations, [&](unsigned long i) { sink += dates[i % samples].dayOfTheWeek(); });
+    double weekdayOld = nanosPerCall(iterations, [&](unsigned long i) {
+        const Civil& c = civils[i % samples];
+        sink += referenceDayOfTheWeek(c.year, c.month, c.day);
+    });
+    double add = nanosPerCall(iterations, [&](unsigned long i) {
+        sink += (dates[i % samples] + TimeSpan((int32_t)(i % 86400))).minute();
+    });
+    double addOld = nanosPerCall(iterations, [&](unsigned long i) {
+        const Civil& c = civils[i % samples];
+        uint32_t t = SECS_1970_TO_2000 + referenceDays(c.year, c.month, c.day) * 86400UL + c.hour * 3600UL +
+                     c.minute * 60 + c.second;
+        sink += referenceCivil(t + i % 86400).minute;
+    });
+    (void)sink;
+
+    printf("ns per call          loop-free  loops\n");
+    printf("DateTime(uint32_t)   %9.1f  %5.1f\n", construct, constructOld);
+    printf("unixtime()           %9.1f  %5.1f\n", unixTime, unixOld);
+    printf("dayOfTheWeek()       %9.1f  %5.1f\n", weekday, weekdayOld);
+    printf("operator+(TimeSpan)  %9.1f  %5.1f\n", add, addOld);
+}
+
+int main() {
+    everyDay();
+    benchmark();
+    return checkResult("datetime");
+}
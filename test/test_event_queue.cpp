@@ -0,0 +1,93 @@
+// EventQueue: FIFO order across many wraps of the ring, the drop counter and statistics when it
+// fills, and a stalling consumer to show no accepted event is lost, repeated or reordered.
+#include "check.h"
+#include "EventQueue.h"
+
+static void order() {
+    EventQueue<uint32_t, 8> queue;
+    uint32_t next = 0, expected = 0, value = 0;
+    // Uneven bursts so head and tail pass every slot position many times
+    for (int round = 0; round < 1000; ++round) {
+        for (int i = 0; i < 1 + round % 8; ++i) CHECK(queue.push(next++));
+        while (queue.pop(value)) CHECK_EQ(value, expected++);
+    }
+    CHECK_EQ(expected, next);
+    CHECK_EQ(queue.getDropped(), 0);
+    CHECK_EQ(queue.getHighWater(), 8);
+    CHECK_EQ(queue.depth(), 0);
+}
+
+static void full() {
+    EventQueue<uint8_t, 4> queue;
+    for (uint8_t i = 0; i < 4; ++i) CHECK(queue.push(i));
+    CHECK(!queue.push(4));
+    CHECK(!queue.push(5));
+    CHECK_EQ(queue.getDropped(), 2);
+    CHECK_EQ(queue.depth(), 4);
+
+    // The oldest events are kept, the dropped ones never appear
+    delay(30);
+    uint8_t value = 0;
+    for (uint8_t i = 0; i < 4; ++i) {
+        CHECK(queue.pop(value));
+        CHECK_EQ(value, i);
+    }
+    CHECK(!queue.pop(value));
+    CHECK_EQ(queue.getProcessed(), 4);
+    CHECK_EQ(queue.getMaxLatencyUs(), 30000);
+    CHECK_EQ(queue.getAverageLatencyUs(), 30000);
+
+    queue.resetStats();
+    CHECK_EQ(queue.getDropped(), 0);
+    CHECK_EQ(queue.getHighWater(), 0);
+    CHECK(queue.push(9));
+}
+
+// Producer bursts between consumer stalls, the way Ticker callbacks run while loop() is blocked.
+// Every attempt carries its own number, so accepted events must come out in order and gapless
+// apart from the refused ones, and each refusal is counted once.
+static void stalledConsumer() {
+    EventQueue<uint32_t, 16> queue;
+    uint32_t attempt = 0, accepted = 0, refused = 0, received = 0, last = 0, value;
+    bool inOrder = true, first = true;
+    uint32_t seed = 12345;
+    for (int round = 0; round < 100000; ++round) {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t burst = (seed >> 16) % 40;
+        for (uint32_t i = 0; i < burst; ++i) {
+            if (queue.push(attempt++)) {
+                accepted++;
+            } else {
+                refused++;
+            }
+        }
+        seed = seed * 1103515245u + 12345u;
+        uint32_t drain = (seed >> 16) % 24;
+        while (drain-- && queue.pop(value)) {
+            inOrder = inOrder && (first || value > last);
+            first = false;
+            last = value;
+            received++;
+        }
+    }
+    while (queue.pop(value)) {
+        inOrder = inOrder && value > last;
+        last = value;
+        received++;
+    }
+    CHECK(inOrder);
+    CHECK(refused > 0);
+    CHECK_EQ(received, accepted);
+    CHECK_EQ(accepted + refused, attempt);
+    CHECK_EQ(queue.getDropped(), refused);
+    CHECK_EQ(queue.getProcessed(), accepted);
+    CHECK_EQ(queue.getHighWater(), 16);
+    printf("%u events offered to a 16 slot queue, %u refused while full\n", attempt, refused);
+}
+
+int main() {
+    order();
+    full();
+    stalledConsumer();
+    return checkResult("event_queue");
+}
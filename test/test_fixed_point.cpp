@@ -0,0 +1,156 @@
+// The integer current, timezone and oscillator trim math against the float code it replaced:
+// every shunt reading, every quarter hour timezone, and the trim for each square wave speed over
+// the whole trim range. Prints how often the old float trim disagreed and the cost of the window
+// statistics in integer and float.
+#include "check.h"
+#include "MCP7940_Scheduler.h"
+#include "PumpGuard.h"
+#include <EEPROM.h>
+#include <NTPClient.h>
+#include <cmath>
+#include <cstdlib>
+
+// The float trim formula of calibrate(float), as it was
+static int floatTrim(int trim, uint32_t fIdeal, float fMeas) {
+    int16_t result = trim;
+    result += ((fMeas - (float)fIdeal) * (32768.0 / fIdeal) * 60.0) / 2.0;
+    if (result > 127) return 127;
+    if (result < -127) return -127;
+    return result;
+}
+
+static void oscillatorTrim() {
+    fakeRtc.reset();
+    Serial.muted = true;
+    MCP7940_Class rtc;
+    rtc.begin();
+    Serial.muted = false;
+    const uint32_t ideal[] = {1, 4096, 8192, 32768};
+    uint32_t checked = 0, floatMismatches = 0;
+    for (uint8_t speed = 0; speed < 4; ++speed) {
+        rtc.setSQWSpeed(speed);
+        const int64_t scale = (int64_t)ideal[speed] * 1000;
+        // Deviations from saturated low to saturated high in 1 mHz steps
+        const int64_t span = 260 * scale / 983040 + 2;
+        for (int start = -127; start <= 127; start += 17) {
+            for (int64_t delta = -span; delta <= span; ++delta) {
+                rtc.calibrate((int8_t)start);
+                uint32_t milliHz = (uint32_t)(scale + delta);
+                int trim = rtc.calibrateMilliHz(milliHz);
+                CHECK_EQ(rtc.getCalibrationTrim(), trim);
+
+                // Exact value of the datasheet formula, truncated toward zero
+                int base = ideal[speed] == 32768 ? 0 : start;
+                long double exact = base + (long double)delta * 983040 / scale;
+                long double truncated = exact < 0 ? ceill(exact) : floorl(exact);
+                int expected = truncated > 127 ? 127 : truncated < -127 ? -127 : (int)truncated;
+                if (trim != expected) {
+                    fprintf(stderr, "trim %d at %u Hz, %+lld mHz: %d, expected %d\n", start, ideal[speed],
+                            (long long)delta, trim, expected);
+                    checkFailures()++;
+                }
+                int old = floatTrim(base, ideal[speed], milliHz / 1000.0f);
+                if (old != trim) {
+                    CHECK(abs(old - trim) <= 1);
+                    floatMismatches++;
+                }
+                checked++;
+            }
+        }
+    }
+    printf("Oscillator trim: %u inputs, old float formula off by one on %u\n", checked, floatMismatches);
+}
+
+static void timezoneOffsets() {
+    fakeRtc.reset();
+    EEPROM.reset();
+    Serial.muted = true;
+    MCP7940Scheduler scheduler;
+    scheduler.begin();
+    MCP7940_Class reader;
+    reader.begin();
+    const uint32_t epoch = 1751490843;  // 2025-07-02 21:14:03 UTC
+    for (int minutes = -12 * 60; minutes <= 14 * 60; minutes += 15) {
+        float hours = minutes / 60.0f;
+        scheduler.setTimeZone(hours);
+        CHECK_EQ(scheduler.getTimeZoneMinutes(), minutes);
+        CHECK(scheduler.getTimeZone() == hours);
+
+        fakeNtpEpoch = epoch;
+        CHECK(scheduler.updateTimeFromNTP());
+        // West of UTC too, the float version cast the offset to unsigned there
+        CHECK_EQ(reader.now().unixtime(), (int64_t)epoch + minutes * 60);
+    }
+    fakeNtpEpoch = 0;
+    Serial.muted = false;
+}
+
+// Every shunt register value, the integer conversion against the float formula on SHUNT
+static void shuntCurrent() {
+    FakeINA219 ina;
+    Wire.attach(INA219_I2C_ADDR, &ina);
+    double worst = 0;
+    for (int32_t raw = -32768; raw <= 32767; ++raw) {
+        ina.reg[1] = (uint16_t)(int16_t)raw;
+        int32_t centiMa = 0;
+        CHECK(PumpGuard::readCurrentCentiMa(centiMa));
+        float milliamps = raw * 0.00001f / (float)SHUNT * 1000.0f;
+        double error = fabs(centiMa - milliamps * 100.0);
+        if (error > worst) worst = error;
+    }
+    CHECK(worst < 1.0);
+    printf("Shunt current: worst difference to float %.3f mA x 100\n", worst);
+    Wire.attach(INA219_I2C_ADDR, nullptr);
+}
+
+// Window statistics in float, the way the samples used to be summarised
+static CurrentStats floatStats(const float* milliamps, size_t count) {
+    float minimum = milliamps[0], maximum = milliamps[0], sum = 0, squares = 0;
+    for (size_t i = 0; i < count; ++i) {
+        minimum = fminf(minimum, milliamps[i]);
+        maximum = fmaxf(maximum, milliamps[i]);
+        sum += milliamps[i];
+        squares += milliamps[i] * milliamps[i];
+    }
+    return {(int32_t)(minimum * 100), (int32_t)(maximum * 100), (int32_t)(sum / count * 100),
+            (int32_t)(sqrtf(squares / count) * 100), (uint16_t)count};
+}
+
+static void windowStats() {
+    CurrentMonitor<CURRENT_WINDOW> monitor(20000, 300000, 0, 3);
+    int32_t samples[CURRENT_WINDOW];
+    float milliamps[CURRENT_WINDOW];
+    srand(7);
+    for (int round = 0; round < 2000; ++round) {
+        monitor.reset(0);
+        double sum = 0, squares = 0;
+        for (size_t i = 0; i < CURRENT_WINDOW; ++i) {
+            samples[i] = 50000 + rand() % 100000 - (round % 10 == 0 ? 60000 : 0);
+            milliamps[i] = samples[i] / 100.0f;
+            sum += samples[i];
+            squares += (double)samples[i] * samples[i];
+            monitor.addSample(samples[i], 0);
+        }
+        CurrentStats stats = monitor.stats();
+        CHECK(fabs(stats.mean - sum / CURRENT_WINDOW) < 1.0);
+        CHECK(fabs(stats.rms - sqrt(squares / CURRENT_WINDOW)) < 1.0);
+    }
+
+    double integer = nanosPerCall(1000000, [&](unsigned long) {
+        CurrentStats stats = monitor.stats();
+        asm volatile("" : : "r"(stats.rms) : "memory");
+    });
+    double floating = nanosPerCall(1000000, [&](unsigned long) {
+        CurrentStats stats = floatStats(milliamps, CURRENT_WINDOW);
+        asm volatile("" : : "r"(stats.rms) : "memory");
+    });
+    printf("Window statistics over %u samples: integer %.1f ns, float %.1f ns\n", CURRENT_WINDOW, integer, floating);
+}
+
+int main() {
+    oscillatorTrim();
+    timezoneOffsets();
+    shuntCurrent();
+    windowStats();
+    return checkResult("fixed_point");
+}
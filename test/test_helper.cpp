@@ -0,0 +1,14 @@
+// Firmware version comparison used by the OTA check
+#include "check.h"
+#include "helper.h"
+
+int main() {
+    CHECK(v1GreaterThanV2("1.3.4", "1.3.3"));
+    CHECK(v1GreaterThanV2("1.10.0", "1.9.9"));
+    CHECK(v1GreaterThanV2("2", "1.9.9"));
+    CHECK(v1GreaterThanV2("1.3.3.1", "1.3.3"));
+    CHECK(!v1GreaterThanV2("1.3.3", "1.3.3"));
+    CHECK(!v1GreaterThanV2("1.3.2", "1.3.3"));
+    CHECK(!v1GreaterThanV2("1.3", "1.3.0"));
+    return checkResult("helper");
+}
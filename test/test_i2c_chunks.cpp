@@ -0,0 +1,99 @@
+// Chunked transfers, built with BUFFER_LENGTH=32 as on cores with a small Wire buffer. On the
+// ESP8266 the 128 byte buffer takes any SRAM block in one transfer, see test_i2c_transfers.
+#include "check.h"
+#include "MCP7940_Scheduler.h"
+#include <EEPROM.h>
+
+static_assert(BUFFER_LENGTH == 32, "built with the small Wire buffer");
+
+static void fill(uint8_t (&data)[64], uint8_t seed) {
+    for (uint8_t i = 0; i < sizeof(data); ++i) data[i] = seed + i * 3;
+}
+
+static void sramRoundTrip() {
+    fakeRtc.reset();
+    MCP7940_Class rtc;
+    rtc.begin();
+    uint8_t written[64], read[64];
+    fill(written, 1);
+
+    // 31 + 31 + 2 data bytes behind each register address, one address write and two reads
+    Wire.resetStats();
+    CHECK(rtc.writeRAM(0, written));
+    CHECK_EQ(Wire.transactions, 3);
+    CHECK_EQ(Wire.writes[0].length, 31);
+    CHECK_EQ(Wire.writes[1].reg, FakeMCP7940::SRAM + 31);
+    CHECK_EQ(Wire.writes[2].length, 2);
+    Wire.resetStats();
+    CHECK_EQ(rtc.readRAM(0, read), 64);
+    CHECK_EQ(Wire.transactions, 3);
+    CHECK(memcmp(written, read, sizeof(read)) == 0);
+    CHECK(memcmp(written, fakeRtc.reg + FakeMCP7940::SRAM, sizeof(written)) == 0);
+
+    // Starting at byte 40 the later chunks carry on at the start of the SRAM
+    fill(written, 100);
+    Wire.resetStats();
+    CHECK(rtc.writeRAM(40, written));
+    CHECK_EQ(Wire.writes[1].reg, FakeMCP7940::SRAM + 7);
+    CHECK_EQ(rtc.readRAM(40, read), 64);
+    CHECK(memcmp(written, read, sizeof(read)) == 0);
+    CHECK_EQ(fakeRtc.reg[FakeMCP7940::SRAM + 40], written[0]);
+    CHECK_EQ(fakeRtc.reg[FakeMCP7940::SRAM], written[24]);
+}
+
+static void failedChunk() {
+    fakeRtc.reset();
+    MCP7940_Class rtc;
+    rtc.begin();
+    uint8_t written[64], read[64];
+    fill(written, 7);
+
+    // The second chunk fails: the first stays written, the rest is untouched
+    Wire.failTransfer(1);
+    CHECK(!rtc.writeRAM(0, written));
+    CHECK_EQ(rtc.getI2CError(), 4);
+    CHECK(memcmp(written, fakeRtc.reg + FakeMCP7940::SRAM, 31) == 0);
+    CHECK_EQ(fakeRtc.reg[FakeMCP7940::SRAM + 31], 0);
+
+    // A read failing after the first chunk returns what it got
+    Wire.failTransfer(2);
+    CHECK_EQ(rtc.readRAM(0, read), 32);
+    CHECK_EQ(rtc.getI2CError(), MCP7940_I2C_SHORT_READ);
+    CHECK(memcmp(written, read, 31) == 0);
+    CHECK_EQ(rtc.readRAM(0, read), 64);
+    CHECK_EQ(rtc.getI2CError(), 0);
+}
+
+// The scheduler's 32 byte banks go in two chunks each and still round trip
+static void schedules() {
+    fakeRtc.reset();
+    EEPROM.reset();
+    Serial.muted = true;
+    MCP7940Scheduler scheduler;
+    scheduler.begin();
+    WateringSchedules schedules{};
+    for (uint8_t i = 0; i < MAX_SCHEDULES; ++i) {
+        schedules.items[i] = {(uint8_t)(i % 24), (uint8_t)(i * 7 % 60), (uint16_t)(30 + i), DOW_EVERYDAY, i % 3 != 0};
+    }
+    CHECK(scheduler.setSchedules(schedules));
+    CHECK(scheduler.flushSchedules(true));  // As before a restart
+
+    MCP7940Scheduler restarted;
+    restarted.begin();
+    WateringSchedules loaded{};
+    CHECK(restarted.getSchedules(loaded));
+    for (uint8_t i = 0; i < MAX_SCHEDULES; ++i) {
+        CHECK_EQ(loaded.items[i].hour, schedules.items[i].hour);
+        CHECK_EQ(loaded.items[i].minute, schedules.items[i].minute);
+        CHECK_EQ(loaded.items[i].duration_sec, schedules.items[i].duration_sec);
+        CHECK_EQ(loaded.items[i].enabled, schedules.items[i].enabled);
+    }
+    Serial.muted = false;
+}
+
+int main() {
+    sramRoundTrip();
+    failedChunk();
+    schedules();
+    return checkResult("i2c_chunks");
+}
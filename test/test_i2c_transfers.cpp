@@ -0,0 +1,152 @@
+// Bus cost of the RTC driver and scheduler calls against the simulated MCP7940. The expected
+// counts are what the driver needs today, a change that adds bus traffic fails here.
+#include "check.h"
+#include "MCP7940_Scheduler.h"
+#include <EEPROM.h>
+
+// Transfers on the bus while fn runs, checked against the driver's own counter
+template <typename Rtc, typename Fn>
+uint32_t transfers(const Rtc& rtc, Fn fn) {
+    uint32_t bus = Wire.transactions;
+    uint32_t counted = rtc.getI2CTransactions();
+    fn();
+    CHECK_EQ(rtc.getI2CTransactions() - counted, Wire.transactions - bus);
+    return Wire.transactions - bus;
+}
+
+// The simulated device itself: BCD rollover, weekday, leap year and the address pointer wrap
+static void simulator() {
+    fakeRtc.reset();
+    fakeRtc.setTime(2024, 2, 28, 23, 59, 59, 3);
+    fakeRtc.tick(1);
+    CHECK_EQ(fakeRtc.reg[FakeMCP7940::RTCDATE], 0x29);
+    CHECK_EQ(fakeRtc.reg[FakeMCP7940::RTCMTH] & 0x1F, 0x02);
+    CHECK_EQ(fakeRtc.reg[FakeMCP7940::RTCMTH] & 0x20, 0x20);  // LPYR
+    CHECK_EQ(fakeRtc.reg[FakeMCP7940::RTCWKDAY] & 0x07, 4);
+    fakeRtc.setTime(2025, 12, 31, 23, 59, 59, 3);
+    fakeRtc.tick(1);
+    CHECK_EQ(fakeRtc.reg[FakeMCP7940::RTCYEAR], 0x26);
+    CHECK_EQ(fakeRtc.reg[FakeMCP7940::RTCMTH], 0x01);
+
+    // Stopping the oscillator clears OSCRUN and freezes the time
+    MCP7940_Class rtc;
+    CHECK(rtc.begin());
+    CHECK(!rtc.deviceStop());
+    uint8_t frozen = fakeRtc.reg[FakeMCP7940::RTCSEC];
+    fakeRtc.tick(5);
+    CHECK_EQ(fakeRtc.reg[FakeMCP7940::RTCSEC], frozen);
+    CHECK(rtc.deviceStart());
+
+    // A read running past the end of the SRAM carries on at its start
+    uint8_t sram[2];
+    fakeRtc.reg[0x5F] = 0xA5;
+    fakeRtc.reg[0x20] = 0x5A;
+    CHECK_EQ(rtc.readRAM(63, sram), 2);
+    CHECK_EQ(sram[0], 0xA5);
+    CHECK_EQ(sram[1], 0x5A);
+}
+
+// Each ALMxMSK setting raises ALMxIF when its fields match
+static void alarmMasks() {
+    struct Case {
+        uint8_t type;
+        uint32_t secondsUntilMatch;
+    };
+    // From Wednesday 2025-07-02 21:14:03 to an alarm at 21:30:00, only the masked fields compare
+    const Case cases[] = {{0, 57}, {1, 15 * 60 + 57}, {7, 15 * 60 + 57}};
+    for (const Case& test : cases) {
+        fakeRtc.reset();
+        MCP7940_Class rtc;
+        rtc.begin();
+        rtc.adjust(DateTime(2025, 7, 2, 21, 14, 3));
+        CHECK(rtc.setAlarm(0, test.type, DateTime(2025, 7, 2, 21, 30, 0)));
+        fakeRtc.tick(test.secondsUntilMatch - 1);
+        CHECK(!rtc.isAlarm(0));
+        fakeRtc.tick(1);
+        CHECK(rtc.isAlarm(0));
+    }
+
+    // Hour mask matches at the top of the next 22:xx hour
+    fakeRtc.reset();
+    MCP7940_Class rtc;
+    rtc.begin();
+    rtc.adjust(DateTime(2025, 7, 2, 21, 14, 3));
+    CHECK(rtc.setAlarm(1, 2, DateTime(2025, 7, 2, 22, 0, 0)));
+    fakeRtc.tick(45 * 60 + 56);
+    CHECK(!rtc.isAlarm(1));
+    fakeRtc.tick(1);
+    CHECK(rtc.isAlarm(1));
+}
+
+static void driverCosts() {
+    fakeRtc.reset();
+    MCP7940_Class rtc;
+    CHECK(rtc.begin());
+    CHECK(rtc.deviceStart());
+
+    CHECK_EQ(transfers(rtc, [&] { rtc.now(); }), 2);
+    CHECK_EQ(transfers(rtc, [&] { rtc.adjust(DateTime(2025, 7, 2, 21, 14, 3)); }), 6);
+    CHECK_EQ(transfers(rtc, [&] { rtc.setAlarm(0, 7, DateTime(2025, 7, 2, 21, 30, 0)); }), 4);
+    CHECK_EQ(transfers(rtc, [&] { rtc.getAlarmStatus(); }), 2);
+    uint8_t sram[64] = {0};
+    CHECK_EQ(transfers(rtc, [&] { rtc.writeRAM(0, sram); }), 1);
+    CHECK_EQ(transfers(rtc, [&] { rtc.readRAM(0, sram); }), 2);
+
+    DateTime time = rtc.now();
+    CHECK_EQ(time.hour(), 21);
+    CHECK_EQ(time.minute(), 14);
+}
+
+// A failed status read leaves the clock and VBATEN alone
+static void adjustReadFailure() {
+    fakeRtc.reset();
+    MCP7940_Class rtc;
+    rtc.begin();
+    rtc.setBattery(true);
+    rtc.adjust(DateTime(2025, 7, 2, 21, 14, 3));
+    uint8_t before[FakeMCP7940::CONTROL];
+    memcpy(before, fakeRtc.reg, sizeof(before));
+
+    uint32_t bus = Wire.transactions;
+    Wire.failTransfer(0);
+    rtc.adjust(DateTime(2030, 1, 1, 0, 0, 0));
+    CHECK(rtc.getI2CError() != 0);
+    CHECK_EQ(Wire.transactions - bus, 1);
+    CHECK(memcmp(before, fakeRtc.reg, sizeof(before)) == 0);
+    CHECK(fakeRtc.reg[FakeMCP7940::RTCWKDAY] & 0x08);
+}
+
+static void schedulerCosts() {
+    fakeRtc.reset();
+    EEPROM.reset();
+    MCP7940Scheduler scheduler;
+    scheduler.begin();
+    fakeRtc.setTime(2025, 7, 2, 21, 14, 3, 3);
+
+    WateringSchedules schedules{};
+    schedules.items[0] = {21, 30, 60, DOW_EVERYDAY, true};
+    CHECK_EQ(transfers(scheduler, [&] { scheduler.setSchedules(schedules); }), 1);
+    CHECK_EQ(transfers(scheduler, [&] { scheduler.setNextAlarm(); }), 7);
+    CHECK_EQ(transfers(scheduler, [&] { scheduler.setManualStopTime(120); }), 7);
+    CHECK_EQ(transfers(scheduler, [&] { scheduler.getSchedules(schedules); }), 0);
+    CHECK_EQ(transfers(scheduler, [&] { scheduler.setSchedule(1, {6, 0, 30, DOW_MONDAY, true}); }), 1);
+    CHECK_EQ(transfers(scheduler, [&] { scheduler.getCurrentTimestamp(); }), 0);
+    CHECK_EQ(transfers(scheduler, [&] { scheduler.getAlarmStatus(); }), 2);
+    CHECK_EQ(transfers(scheduler, [&] { scheduler.verifySchedules(); }), 4);
+
+    // The programmed ON alarm fires at 21:30:00
+    scheduler.setNextAlarm();
+    fakeRtc.tick(15 * 60 + 56);
+    CHECK(!scheduler.getAlarmStatus().triggered[ALARM::ONTRIGGER]);
+    fakeRtc.tick(1);
+    CHECK(scheduler.getAlarmStatus().triggered[ALARM::ONTRIGGER]);
+}
+
+int main() {
+    simulator();
+    alarmMasks();
+    driverCosts();
+    adjustReadFailure();
+    schedulerCosts();
+    return checkResult("i2c_transfers");
+}
@@ -0,0 +1,205 @@
+// MqttConnection against a slow resolver and a stalled broker, stepped from a simulated loop()
+// every 10 ms. The lookup never blocks, the blocking phases wait for MQTT_DEFER_MAX at most while
+// the pump runs and stay within their timeouts otherwise, and the retry delay grows as it should.
+#include "check.h"
+#include "MqttConnection.h"
+
+static const char* const topics[] = {"beegreen/pump_trigger", "beegreen/set_schedule", "beegreen/restart"};
+
+static const char* topicAt(size_t index) {
+    return index < sizeof(topics) / sizeof(topics[0]) ? topics[index] : nullptr;
+}
+
+struct Rig {
+    BearSSL::WiFiClientSecure tls;
+    PubSubClient mqtt;
+    MqttConnection connection;
+
+    Rig() : mqtt(tls), connection(mqtt, tls, topicAt) {
+        Serial.muted = true;
+        fakeDns = FakeDns();
+        connection.begin("broker.example", 8883, "beegreen", "user", "secret");
+    }
+
+    ~Rig() { Serial.muted = false; }
+
+    // loop() iterations for `milliseconds`, returns the longest single step()
+    uint32_t run(uint32_t milliseconds, bool mayBlock = true) {
+        uint32_t longest = 0;
+        uint32_t until = millis() + milliseconds;
+        while ((int32_t)(millis() - until) < 0) {
+            uint32_t started = millis();
+            connection.step(millis(), mayBlock);
+            if (millis() - started > longest) longest = millis() - started;
+            delay(10);
+        }
+        return longest;
+    }
+};
+
+static void connects() {
+    Rig rig;
+    uint32_t steps = 0;
+    while (!rig.connection.isConnected() && steps < 20) {
+        rig.connection.step(millis());
+        steps++;
+    }
+    // BACKOFF, RESOLVE, TLS, CONNECT, three SUBSCRIBEs and the last one that finds no more
+    CHECK_EQ(steps, 8);
+    CHECK_EQ(rig.mqtt.subscriptions.size(), 3);
+    CHECK(rig.mqtt.subscriptions[2] == "beegreen/restart");
+    CHECK_EQ(rig.connection.getAttempts(), 1);
+    CHECK_EQ(rig.connection.getFailures(), 0);
+
+    // A dropped broker connection goes back to the backoff
+    rig.mqtt.disconnect();
+    CHECK_EQ(rig.connection.step(millis()), MqttConnection::BACKOFF);
+    CHECK_EQ(rig.connection.getFailures(), 1);
+    CHECK(rig.connection.getBackoffMs() > 0);
+}
+
+// The OTA check borrows the socket and resets the connection afterwards: the next steps reconnect
+// at once instead of finding the connection lost and backing off
+static void resetAfterOta() {
+    Rig rig;
+    rig.run(100);
+    CHECK(rig.connection.isConnected());
+    rig.mqtt.disconnect();
+    rig.connection.reset();
+    rig.run(100);
+    CHECK(rig.connection.isConnected());
+    CHECK_EQ(rig.connection.getFailures(), 0);
+    CHECK_EQ(rig.connection.getAttempts(), 2);
+}
+
+static void slowLookup() {
+    Rig rig;
+    fakeDns.cached = false;
+    CHECK_EQ(rig.run(500), 0);
+    CHECK_EQ(rig.connection.getPhase(), MqttConnection::RESOLVE);
+    CHECK_EQ(fakeDns.lookups, 1);
+    fakeDns.answer(true);
+    CHECK_EQ(rig.run(100), 0);
+    CHECK(rig.connection.isConnected());
+
+    // No answer at all: the lookup gives up after MQTT_DNS_TIMEOUT, still without blocking
+    Rig silent;
+    fakeDns.cached = false;
+    uint32_t started = millis();
+    CHECK_EQ(silent.run(MQTT_DNS_TIMEOUT + 100), 0);
+    CHECK_EQ(silent.connection.getLastFailedPhase(), MqttConnection::RESOLVE);
+    CHECK_EQ(silent.connection.getFailures(), 1);
+    CHECK(silent.connection.getPhaseMs(MqttConnection::RESOLVE) >= MQTT_DNS_TIMEOUT);
+    CHECK(millis() - started >= MQTT_DNS_TIMEOUT);
+    CHECK_EQ(silent.tls.connects, 0);
+
+    // The answer arriving after the timeout is dropped, the next attempt looks up again and
+    // connects on its own answer
+    fakeDns.answer(true);
+    while (silent.connection.getPhase() == MqttConnection::BACKOFF) silent.run(10);
+    silent.run(10);
+    CHECK_EQ(fakeDns.lookups, 2);
+    CHECK_EQ(silent.connection.getPhase(), MqttConnection::RESOLVE);
+    CHECK_EQ(silent.tls.connects, 0);
+    fakeDns.answer(true);
+    silent.run(100);
+    CHECK(silent.connection.isConnected());
+
+    // A failed lookup fails the attempt at once
+    Rig failed;
+    fakeDns.cached = false;
+    failed.run(50);
+    fakeDns.answer(false);
+    failed.run(20);
+    CHECK_EQ(failed.connection.getLastFailedPhase(), MqttConnection::RESOLVE);
+}
+
+static void heldWhilePumping() {
+    // The lookup goes ahead while the pump runs, the handshake waits
+    Rig rig;
+    fakeDns.cached = false;
+    CHECK_EQ(rig.run(MQTT_DNS_TIMEOUT / 2, false), 0);
+    CHECK_EQ(fakeDns.lookups, 1);
+    fakeDns.answer(true);
+    CHECK_EQ(rig.run(MQTT_DEFER_MAX / 2, false), 0);
+    CHECK_EQ(rig.connection.getPhase(), MqttConnection::TLS);
+    CHECK_EQ(rig.tls.connects, 0);
+    CHECK_EQ(rig.mqtt.connects, 0);
+    CHECK_EQ(rig.connection.getFailures(), 0);
+
+    rig.run(100);
+    CHECK(rig.connection.isConnected());
+    CHECK(rig.connection.getPhaseMs(MqttConnection::TLS) < 100);
+
+    // A handshake that would stall is not started while the pump runs, until the deferral is up
+    Rig stalled;
+    stalled.tls.stallMs = MQTT_TLS_TIMEOUT;
+    CHECK_EQ(stalled.run(MQTT_DEFER_MAX - 100, false), 0);
+    CHECK_EQ(stalled.connection.getPhase(), MqttConnection::TLS);
+    CHECK_EQ(stalled.tls.connects, 0);
+    CHECK_EQ(stalled.run(200, false), MQTT_TLS_TIMEOUT);
+    CHECK_EQ(stalled.tls.connects, 1);
+    CHECK_EQ(stalled.connection.getLastFailedPhase(), MqttConnection::TLS);
+
+    // Nor does the deferral outlast MQTT_DEFER_MAX: the pump running for good still connects
+    Rig longRun;
+    longRun.run(MQTT_DEFER_MAX + 100, false);
+    CHECK(longRun.connection.isConnected());
+
+    // The pump starting between the handshake and CONNECT holds the CONNECT
+    Rig late;
+    for (int i = 0; i < 3; ++i) late.connection.step(millis());
+    CHECK_EQ(late.connection.getPhase(), MqttConnection::CONNECT);
+    CHECK_EQ(late.run(10000, false), 0);
+    CHECK_EQ(late.mqtt.connects, 0);
+    late.run(100);
+    CHECK(late.connection.isConnected());
+    CHECK(late.connection.getPhaseMs(MqttConnection::CONNECT) < 100);
+}
+
+static void stalledBroker() {
+    Rig rig;
+    rig.mqtt.brokerStalled = true;
+    uint32_t longest = rig.run(120000);
+    CHECK_EQ(longest, MQTT_CONNECT_TIMEOUT);
+    CHECK(!rig.connection.isConnected());
+    CHECK_EQ(rig.connection.getLastFailedPhase(), MqttConnection::CONNECT);
+
+    // A handshake that never completes is cut at MQTT_TLS_TIMEOUT
+    Rig silent;
+    silent.tls.stallMs = 60000;
+    CHECK_EQ(silent.run(30000), MQTT_TLS_TIMEOUT);
+    CHECK_EQ(silent.connection.getLastFailedPhase(), MqttConnection::TLS);
+
+    // Retry delays double from MQTT_BACKOFF_MIN up to MQTT_BACKOFF_MAX, each randomised into its
+    // upper half
+    Rig refused;
+    refused.tls.accepting = false;
+    uint32_t expected = MQTT_BACKOFF_MIN;
+    for (int attempt = 0; attempt < 12; ++attempt) {
+        uint32_t failures = refused.connection.getFailures();
+        while (refused.connection.getFailures() == failures) {
+            refused.connection.step(millis());
+            delay(10);
+        }
+        uint32_t backoff = refused.connection.getBackoffMs();
+        CHECK(backoff >= expected / 2 && backoff <= expected);
+        expected = expected * 2 > MQTT_BACKOFF_MAX ? MQTT_BACKOFF_MAX : expected * 2;
+    }
+    CHECK_EQ(refused.connection.getAttempts(), 12);
+
+    // While the pump runs a stalled broker blocks loop() once per MQTT_DEFER_MAX at most
+    Rig pumping;
+    pumping.mqtt.brokerStalled = true;
+    CHECK_EQ(pumping.run(120000, false), MQTT_CONNECT_TIMEOUT);
+    CHECK(pumping.connection.getAttempts() <= 120000 / MQTT_DEFER_MAX);
+}
+
+int main() {
+    connects();
+    resetAfterOta();
+    slowLookup();
+    heldWhilePumping();
+    stalledBroker();
+    return checkResult("mqtt_connection");
+}
@@ -0,0 +1,120 @@
+// MqttOutbox against a reference PUBLISH encoder: packets queued in one loop() leave in a single
+// write with their order, retained flag and remaining length intact, a full buffer flushes early,
+// an oversized packet goes out on its own, and a short write is counted, drops the batch and fails
+// the flush that follows.
+#include "check.h"
+#include "MqttOutbox.h"
+#include <string>
+
+// QoS 0 PUBLISH as PubSubClient builds it
+static std::string packet(const std::string& topic, const std::string& payload, bool retained = false) {
+    std::string out(1, (char)(0x30 | (retained ? 1 : 0)));
+    size_t remaining = 2 + topic.size() + payload.size();
+    do {
+        uint8_t digit = remaining % 128;
+        remaining /= 128;
+        out += (char)(digit | (remaining > 0 ? 0x80 : 0));
+    } while (remaining > 0);
+    out += (char)(topic.size() >> 8);
+    out += (char)(topic.size() & 0xFF);
+    return out + topic + payload;
+}
+
+static void coalesced() {
+    RecordingClient client;
+    MqttOutbox<1024> outbox(client);
+    std::string payload(200, 'x');  // Two byte remaining length
+    CHECK(outbox.publish("beegreen/pump_status", "off", true));
+    CHECK(outbox.publish("beegreen/pump_run_summary", payload.c_str()));
+    CHECK(outbox.publish("beegreen/next_schedule_due", "", true));
+    CHECK_EQ(client.writes, 0);
+    CHECK_EQ(outbox.pending(), 3);
+
+    CHECK(outbox.flush());
+    std::string expected = packet("beegreen/pump_status", "off", true) + packet("beegreen/pump_run_summary", payload) +
+                           packet("beegreen/next_schedule_due", "", true);
+    CHECK(client.sent == expected);
+    CHECK_EQ(client.writes, 1);
+    CHECK_EQ(outbox.getPackets(), 3);
+    CHECK_EQ(outbox.getWrites(), 1);
+    CHECK_EQ(outbox.getBytes(), expected.size());
+    CHECK_EQ(outbox.getMaxCoalesced(), 3);
+    CHECK_EQ(outbox.pending(), 0);
+
+    // Nothing queued, nothing written
+    CHECK(outbox.flush());
+    CHECK_EQ(client.writes, 1);
+}
+
+static void earlyAndOversized() {
+    RecordingClient client;
+    MqttOutbox<64> outbox(client);
+    // 29 byte packets, the third does not fit behind the first two
+    CHECK(outbox.publish("beegreen/topic_a", "123456789"));
+    CHECK(outbox.publish("beegreen/topic_b", "123456789"));
+    CHECK_EQ(client.writes, 0);
+    CHECK(outbox.publish("beegreen/topic_c", "123456789"));
+    CHECK_EQ(client.writes, 1);
+    CHECK_EQ(outbox.pending(), 1);
+
+    // Larger than the whole buffer: the queued one goes first, then this one unbuffered
+    std::string big(100, 'y');
+    CHECK(outbox.publish("beegreen/big", big.c_str(), true));
+    CHECK_EQ(outbox.pending(), 0);
+    CHECK_EQ(client.writes, 6);
+    CHECK(client.sent == packet("beegreen/topic_a", "123456789") + packet("beegreen/topic_b", "123456789") +
+                             packet("beegreen/topic_c", "123456789") + packet("beegreen/big", big, true));
+    CHECK_EQ(outbox.getWrites(), 6);
+    CHECK_EQ(outbox.getFailures(), 0);
+}
+
+static void shortWrite() {
+    RecordingClient client;
+    MqttOutbox<64> outbox(client);
+    client.accept = 10;
+    CHECK(outbox.publish("beegreen/topic_a", "123456789"));
+    CHECK(!outbox.flush());
+    CHECK_EQ(outbox.getFailures(), 1);
+    CHECK_EQ(outbox.getBytes(), 0);
+    CHECK_EQ(outbox.pending(), 0);  // The batch is gone, the connection is broken anyway
+
+    // A publish that needs an early flush fails with it and is not queued
+    client.accept = SIZE_MAX;
+    CHECK(outbox.publish("beegreen/topic_a", "123456789"));
+    CHECK(outbox.publish("beegreen/topic_b", "123456789"));
+    client.accept = 0;
+    CHECK(!outbox.publish("beegreen/topic_c", "123456789"));
+    CHECK_EQ(outbox.pending(), 0);
+    CHECK_EQ(outbox.getFailures(), 2);
+
+    // A batch lost in a forced early write fails the next flush, though that one has nothing left
+    // to write, so a caller waiting for its message to go out does not take it as sent
+    client.accept = SIZE_MAX;
+    CHECK(outbox.publish("beegreen/topic_a", "123456789"));
+    CHECK(outbox.publish("beegreen/topic_b", "123456789"));
+    client.accept = 0;
+    CHECK(!outbox.publish("beegreen/topic_c", "123456789"));
+    client.accept = SIZE_MAX;
+    CHECK(!outbox.flush());
+    CHECK(outbox.flush());
+    CHECK_EQ(outbox.getFailures(), 3);
+
+    // clear() drops the queue without writing
+    client.accept = SIZE_MAX;
+    uint32_t writes = client.writes;
+    CHECK(outbox.publish("beegreen/topic_a", "123456789"));
+    outbox.clear();
+    CHECK(outbox.flush());
+    CHECK_EQ(client.writes, writes);
+
+    outbox.resetStats();
+    CHECK_EQ(outbox.getPackets(), 0);
+    CHECK_EQ(outbox.getFailures(), 0);
+}
+
+int main() {
+    coalesced();
+    earlyAndOversized();
+    shortWrite();
+    return checkResult("mqtt_outbox");
+}
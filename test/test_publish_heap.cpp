@@ -0,0 +1,134 @@
+// Publishing stays off the heap: the payloads the sketch builds with PublishMessages.h, queued in
+// the MqttOutbox and flushed, with every operator new counted. Also checks the payload text against
+// what String and snprintf produced before, and that a payload too long for its buffer is refused.
+#include "check.h"
+#include "PublishMessages.h"
+#include "MqttOutbox.h"
+#include "RunAccumulator.h"
+#include "MCP7940_Scheduler.h"
+#include <Client.h>
+#include <EEPROM.h>
+#include <new>
+
+static unsigned long allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* memory = malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+
+static RecordingClient client;
+static MqttOutbox<1024> outbox(client);
+static MCP7940Scheduler rtc;
+
+// The publish paths of the sketch around the shared builders
+static void publishMsg(const char* topic, const char* payload, bool retained) {
+    StatusMessage jsonPayload;
+    CHECK(buildStatusMessage(jsonPayload, payload, rtc.getCurrentTimestamp()));
+    outbox.publish(topic, jsonPayload.c_str(), retained);
+}
+
+static void publishSchedules() {
+    WateringSchedules allSchedules;
+    rtc.getSchedules(allSchedules);
+    static ScheduleListMessage scheduleList;
+    CHECK(buildScheduleList(scheduleList, allSchedules));
+    outbox.publish("beegreen/get_schedules_response", scheduleList.c_str());
+}
+
+static void publishRunSummary(const RunAccumulator& pumpRun) {
+    RunSummaryMessage summary;
+    CHECK(buildRunSummary(summary, pumpRun, rtc.getCurrentTimestamp()));
+    outbox.publish("beegreen/pump_run_summary", summary.c_str());
+}
+
+static void noAllocations() {
+    Serial.muted = true;
+    fakeRtc.reset();
+    EEPROM.reset();
+    rtc.begin();
+    fakeRtc.setTime(2025, 7, 2, 21, 14, 3, 3);
+    // Widest entries so the schedule list is as long as it gets
+    WateringSchedules schedules{};
+    for (uint8_t i = 0; i < MAX_SCHEDULES; ++i) {
+        schedules.items[i] = {23, 59, SCHEDULE_DURATION_MAX, DOW_EVERYDAY, true};
+    }
+    rtc.setSchedules(schedules);
+    rtc.setNextAlarm();
+    RunAccumulator pumpRun;
+    pumpRun.begin(0);
+    pumpRun.setBusVoltage(12000);
+    for (uint32_t ms = 50; ms <= 60000; ms += 50) pumpRun.addCurrent(123456, ms);
+    pumpRun.end(60000, STOP_ALARM);
+
+    client.sent.reserve(4096);  // The recording itself must not count
+    unsigned long before = allocations;
+    for (int round = 0; round < 100; ++round) {
+        MessageBuilder<16> value;
+        value.appendFixed(-12345, 2);
+        publishMsg("beegreen/current_consumption", value.c_str(), false);
+        publishMsg("beegreen/pump_status", "on", true);
+        MessageBuilder<TIMESTAMP_SIZE> timestamp;
+        timestamp.appendTimestamp(rtc.getNextDueAlarm());
+        outbox.publish("beegreen/next_schedule_due", timestamp.c_str(), true);
+        publishRunSummary(pumpRun);
+        publishSchedules();
+        outbox.flush();
+        client.sent.clear();
+        delay(1000);
+    }
+    CHECK_EQ(allocations - before, 0);
+    Serial.muted = false;
+}
+
+// The text matches what String(float, 2), String(long) and the old timestamp produced. Values
+// halfway between two hundredths are left out, printf and the core's dtostrf() round them apart.
+static void sameText() {
+    const float floats[] = {0.0f, 0.004f, 1.5f, 12.345f, -7.25f, 429496.72f};
+    for (float value : floats) {
+        MessageBuilder<32> text;
+        text.appendFloat(value, 2);
+        char expected[32];
+        snprintf(expected, sizeof(expected), "%.2f", value);
+        CHECK(strcmp(text.c_str(), expected) == 0);
+    }
+    const long fixed[] = {0, 5, -5, 100, 12345, -987654};
+    for (long value : fixed) {
+        MessageBuilder<32> text;
+        text.appendFixed(value, 2);
+        char expected[32];
+        snprintf(expected, sizeof(expected), "%s%ld.%02ld", value < 0 ? "-" : "", labs(value) / 100, labs(value) % 100);
+        CHECK(strcmp(text.c_str(), expected) == 0);
+    }
+    MessageBuilder<TIMESTAMP_SIZE> timestamp;
+    timestamp.appendTimestamp(DateTime(2025, 1, 2, 3, 4, 5));
+    CHECK(strcmp(timestamp.c_str(), "2025-01-02 03:04:05") == 0);
+    CHECK(!timestamp.overflowed());
+
+    // Overflow truncates and says so
+    MessageBuilder<8> small;
+    small.append("0123456789");
+    CHECK(small.overflowed());
+    CHECK(strcmp(small.c_str(), "0123456") == 0);
+
+    // A status payload that does not fit is refused, the sketch then skips the publish
+    char longPayload[200];
+    memset(longPayload, 'x', sizeof(longPayload) - 1);
+    longPayload[sizeof(longPayload) - 1] = '\0';
+    StatusMessage status;
+    CHECK(!buildStatusMessage(status, longPayload, "2025-01-02 03:04:05"));
+    CHECK(buildStatusMessage(status, "on", "2025-01-02 03:04:05"));
+    CHECK(strcmp(status.c_str(), "{\"payload\":\"on\",\"timestamp\":\"2025-01-02 03:04:05\"}") == 0);
+}
+
+int main() {
+    noAllocations();
+    sameText();
+    return checkResult("publish_heap");
+}
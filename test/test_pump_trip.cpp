@@ -0,0 +1,137 @@
+// Trip latency of the pump guard against a simulated INA219, with loop() blocked the whole time
+// the way a TLS connect blocks it. The sampler Timer alone must cut the MOSFET within the
+// debounce samples, where the queued sample events of the old path waited for loop() and were
+// dropped once the queue filled. A sampler tick that finds loop() holding the bus skips its read.
+#include "check.h"
+#include "Timer.h"
+#include "EventQueue.h"
+#include "PumpGuard.h"
+
+static FakeINA219 ina;
+static CurrentMonitor<CURRENT_WINDOW> monitor(200 * 100, 3000 * 100, INRUSH_GRACE_MS, CURRENT_TRIP_SAMPLES);
+static RunAccumulator run;
+static PumpGuard guard(monitor, run);
+static Timer sampler(CURRENT_SAMPLE_INTERVAL, Timer::SCHEDULER, [] {
+    if (guard.sample(millis()) != PumpGuard::Monitor::NONE) sampler.stop();
+});
+
+static void startPump(int16_t currentMa) {
+    ina.setCurrentMa(currentMa, SHUNT_MILLIOHM);
+    digitalWrite(MOSFET_PIN, HIGH);
+    guard.begin(millis());
+    sampler.start();
+}
+
+// Milliseconds from now until the MOSFET goes low, running only the Tickers, or `limit`
+static uint32_t runUntilCut(uint32_t limit) {
+    uint32_t started = millis();
+    while (digitalRead(MOSFET_PIN) && millis() - started < limit) Ticker::runTickers(1);
+    return millis() - started;
+}
+
+static void dryRun() {
+    startPump(800);
+    Ticker::runTickers(3000);
+    CHECK(digitalRead(MOSFET_PIN));
+    CHECK(guard.takeTrip() == PumpGuard::Monitor::NONE);
+
+    ina.setCurrentMa(40, SHUNT_MILLIOHM);  // Tank empty
+    uint32_t latency = runUntilCut(5000);
+    printf("Dry run cut after %u ms with loop() blocked\n", latency);
+    CHECK(latency <= CURRENT_TRIP_SAMPLES * CURRENT_SAMPLE_INTERVAL);
+    CHECK(!digitalRead(MOSFET_PIN));
+    CHECK(!sampler.isRunning());
+
+    // loop() comes back later and finishes the stop once
+    Ticker::runTickers(5000);
+    CHECK(guard.takeTrip() == PumpGuard::Monitor::DRY_RUN);
+    CHECK(guard.takeTrip() == PumpGuard::Monitor::NONE);
+    CHECK_EQ(run.getStopReason(), STOP_DRY_RUN);
+    CHECK_EQ(run.getRuntimeMs(), 3000 + latency);
+    CHECK_EQ(monitor.getTripLatencyMs(), (CURRENT_TRIP_SAMPLES - 1) * CURRENT_SAMPLE_INTERVAL);
+}
+
+static void overCurrent() {
+    startPump(5000);  // Inrush is allowed for the grace period
+    Ticker::runTickers(INRUSH_GRACE_MS - CURRENT_SAMPLE_INTERVAL);
+    CHECK(digitalRead(MOSFET_PIN));
+    ina.setCurrentMa(900, SHUNT_MILLIOHM);
+    Ticker::runTickers(2000);
+    CHECK(digitalRead(MOSFET_PIN));
+
+    ina.setCurrentMa(4200, SHUNT_MILLIOHM);  // Blocked impeller
+    uint32_t latency = runUntilCut(5000);
+    printf("Over current cut after %u ms with loop() blocked\n", latency);
+    CHECK(latency <= CURRENT_TRIP_SAMPLES * CURRENT_SAMPLE_INTERVAL);
+    CHECK(guard.takeTrip() == PumpGuard::Monitor::OVER_CURRENT);
+    CHECK_EQ(run.getStopReason(), STOP_OVER_CURRENT);
+    CHECK_EQ(run.getPeakMa(), 5000);
+}
+
+// Failed reads are skipped, they neither trip nor count as an in-range sample
+static void readFailures() {
+    startPump(800);
+    Ticker::runTickers(2000);
+    uint32_t samples = run.getSamples();
+    Wire.failTransfer(0);
+    Ticker::runTickers(CURRENT_SAMPLE_INTERVAL);
+    CHECK_EQ(guard.getReadFailures(), 1);
+    CHECK_EQ(run.getSamples(), samples);
+    CHECK(digitalRead(MOSFET_PIN));
+
+    // A stopped pump is not sampled
+    digitalWrite(MOSFET_PIN, LOW);
+    sampler.stop();
+    Ticker::runTickers(1000);
+    CHECK_EQ(run.getSamples(), samples);
+}
+
+// A tick landing while loop() holds the bus for an RTC transfer leaves the bus alone, the next
+// free tick reads again
+static void busHeld() {
+    startPump(800);
+    Ticker::runTickers(2000);
+    uint32_t samples = run.getSamples();
+    uint32_t failures = guard.getReadFailures();
+    uint32_t transfers = Wire.transactions;
+    {
+        I2CBusLock loopTransfer;
+        Ticker::runTickers(CURRENT_SAMPLE_INTERVAL * 2);
+        CHECK_EQ(Wire.transactions, transfers);
+    }
+    CHECK_EQ(guard.getBusySkips(), 2);
+    CHECK_EQ(run.getSamples(), samples);
+    CHECK(!I2CBus::busy());
+    Ticker::runTickers(CURRENT_SAMPLE_INTERVAL);
+    CHECK_EQ(run.getSamples(), samples + 1);
+    CHECK_EQ(guard.getReadFailures(), failures);
+    digitalWrite(MOSFET_PIN, LOW);
+    sampler.stop();
+}
+
+// The old path: the sampler queued an event and loop() read the INA219. Blocked for 5 s, loop()
+// sees the dry run only when it returns, and the queue has dropped most of the samples.
+static EventQueue<uint8_t, 16> queuedSamples;
+
+static void queuedPath() {
+    Timer queuing(CURRENT_SAMPLE_INTERVAL, Timer::SCHEDULER, [] { queuedSamples.push(0); });
+    queuing.start();
+    uint32_t dropAt = millis();
+    Ticker::runTickers(5000);
+    queuing.stop();
+    printf("Queued samples: dry run seen after %u ms, %u of %u samples dropped\n", millis() - dropAt,
+           queuedSamples.getDropped(), queuedSamples.getDropped() + (uint32_t)queuedSamples.depth());
+    CHECK_EQ(queuedSamples.depth(), 16);
+    CHECK_EQ(queuedSamples.getDropped(), 5000 / CURRENT_SAMPLE_INTERVAL - 16);
+}
+
+int main() {
+    Wire.attach(INA219_I2C_ADDR, &ina);
+    ina.setBusMillivolts(12000);
+    dryRun();
+    overCurrent();
+    readFailures();
+    busHeld();
+    queuedPath();
+    return checkResult("pump_trip");
+}
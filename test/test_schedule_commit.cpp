@@ -0,0 +1,83 @@
+// EEPROM commits of the overflow records: a burst of slot edits shares one sector rewrite once
+// the edits go quiet, a steady stream still commits within the maximum delay, and an unchanged
+// block never reaches the flash.
+#include "check.h"
+#include "MCP7940_Scheduler.h"
+#include <EEPROM.h>
+
+static void startScheduler(MCP7940Scheduler& scheduler) {
+    fakeRtc.reset();
+    EEPROM.reset();
+    scheduler.begin();
+    WateringSchedules schedules{};
+    scheduler.setSchedules(schedules);
+    scheduler.flushSchedules(true);
+}
+
+static void burst() {
+    MCP7940Scheduler scheduler;
+    startScheduler(scheduler);
+    uint32_t writes = EEPROM.flashWrites;
+
+    // Twenty edits of overflow slots a second apart, then quiet
+    for (uint8_t i = 0; i < 20; ++i) {
+        CHECK(scheduler.setSchedule(SRAM_SCHEDULES + i, {6, i, 60, DOW_EVERYDAY, true}));
+        scheduler.flushSchedules();
+        delay(1000);
+    }
+    CHECK_EQ(EEPROM.flashWrites, writes);
+    delay(SCHEDULE_COMMIT_QUIET_MS - 1000);
+    CHECK(scheduler.flushSchedules());
+    CHECK_EQ(EEPROM.flashWrites, writes + 1);
+
+    // After a restart the committed records are back
+    MCP7940Scheduler restarted;
+    restarted.begin();
+    ScheduleItem item;
+    CHECK(restarted.getSchedule(SRAM_SCHEDULES + 19, item));
+    CHECK_EQ(item.minute, 19);
+    CHECK(item.enabled);
+}
+
+static void steadyStream() {
+    MCP7940Scheduler scheduler;
+    startScheduler(scheduler);
+    uint32_t writes = EEPROM.flashWrites;
+
+    // An edit every 5 s never goes quiet, the maximum delay still commits
+    for (uint32_t second = 0; second <= SCHEDULE_COMMIT_MAX_MS / 1000; second += 5) {
+        scheduler.setSchedule(MAX_SCHEDULES - 1, {7, (uint8_t)(second % 60), 30, DOW_MONDAY, true});
+        scheduler.flushSchedules();
+        delay(5000);
+    }
+    CHECK_EQ(EEPROM.flashWrites, writes + 1);
+}
+
+static void unchanged() {
+    MCP7940Scheduler scheduler;
+    startScheduler(scheduler);
+    uint32_t writes = EEPROM.flashWrites;
+
+    // Writing back what is stored, or editing only the RTC RAM slots, leaves the flash alone
+    ScheduleItem item;
+    scheduler.getSchedule(MAX_SCHEDULES - 1, item);
+    scheduler.setSchedule(MAX_SCHEDULES - 1, item);
+    scheduler.setSchedule(0, {5, 0, 60, DOW_EVERYDAY, true});
+    CHECK(scheduler.flushSchedules(true));
+    CHECK_EQ(EEPROM.flashWrites, writes);
+
+    // Pending records are not mistaken for EEPROM damage
+    scheduler.setSchedule(MAX_SCHEDULES - 1, {5, 0, 60, DOW_EVERYDAY, true});
+    CHECK(scheduler.verifySchedules());
+    CHECK_EQ(EEPROM.flashWrites, writes);
+    CHECK(scheduler.flushSchedules(true));
+    CHECK_EQ(EEPROM.flashWrites, writes + 1);
+}
+
+int main() {
+    Serial.muted = true;
+    burst();
+    steadyStream();
+    unchanged();
+    return checkResult("schedule_commit");
+}
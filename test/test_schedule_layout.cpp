@@ -0,0 +1,109 @@
+// Boot-time recognition of the RTC RAM contents: a blank or erased RTC starts an empty schedule
+// set without a migration, a ScheduleItem[10] image from the old firmware is migrated, and a torn
+// bank write falls back to the other bank.
+#include "check.h"
+#include "MCP7940_Scheduler.h"
+#include <EEPROM.h>
+
+static bool contains(const std::string& text, const char* line) { return text.find(line) != std::string::npos; }
+
+// Boot a scheduler on the given RTC RAM image and return what it logged
+static std::string boot(MCP7940Scheduler& scheduler, const uint8_t (&sram)[64]) {
+    fakeRtc.reset();
+    EEPROM.reset();
+    memcpy(fakeRtc.reg + FakeMCP7940::SRAM, sram, sizeof(sram));
+    Serial.capture = true;
+    Serial.output.clear();
+    scheduler.begin();
+    WateringSchedules schedules;
+    CHECK(scheduler.getSchedules(schedules));
+    Serial.capture = false;
+    return Serial.output;
+}
+
+static uint8_t enabledSchedules(MCP7940Scheduler& scheduler) {
+    WateringSchedules schedules;
+    scheduler.getSchedules(schedules);
+    uint8_t enabled = 0;
+    for (const ScheduleItem& item : schedules.items) enabled += item.enabled;
+    return enabled;
+}
+
+static void blank() {
+    for (uint8_t fill : {0x00, 0xFF, 0xA5}) {
+        uint8_t sram[64];
+        memset(sram, fill, sizeof(sram));
+        MCP7940Scheduler scheduler;
+        std::string log = boot(scheduler, sram);
+        CHECK(!contains(log, "Migrating"));
+        CHECK(!contains(log, "No valid schedule bank"));
+        CHECK_EQ(enabledSchedules(scheduler), 0);
+    }
+}
+
+static void legacyImage() {
+    // What the old firmware wrote: ScheduleItem[10] at RTC RAM address 0
+    ScheduleItem legacy[10] = {};
+    legacy[0] = {6, 30, 600, DOW_EVERYDAY, true};
+    legacy[4] = {18, 0, 120, DOW_MONDAY | DOW_FRIDAY, true};
+    legacy[7] = {7, 15, 60, DOW_SUNDAY, false};
+    uint8_t sram[64] = {};
+    memcpy(sram, legacy, sizeof(legacy));
+
+    MCP7940Scheduler scheduler;
+    std::string log = boot(scheduler, sram);
+    CHECK(contains(log, "Migrating"));
+    CHECK_EQ(enabledSchedules(scheduler), 2);
+    ScheduleItem item;
+    scheduler.getSchedule(4, item);
+    CHECK_EQ(item.hour, 18);
+    CHECK_EQ(item.duration_sec, 120);
+    CHECK_EQ(item.daysOfWeek, DOW_MONDAY | DOW_FRIDAY);
+    scheduler.getSchedule(7, item);
+    CHECK(!item.enabled);
+    CHECK_EQ(item.minute, 15);
+
+    // The image was replaced by a bank, the next boot finds that instead. The migration committed
+    // the slots that moved to the EEPROM before overwriting the image, a restart keeps them.
+    Serial.capture = true;
+    Serial.output.clear();
+    MCP7940Scheduler restarted;
+    restarted.begin();
+    CHECK_EQ(enabledSchedules(restarted), 2);
+    Serial.capture = false;
+    CHECK(!contains(Serial.output, "Migrating"));
+    restarted.getSchedule(7, item);
+    CHECK_EQ(item.hour, 7);
+    CHECK_EQ(item.minute, 15);
+
+    // An image of disabled items only carries nothing worth migrating
+    legacy[0].enabled = legacy[4].enabled = false;
+    memcpy(sram, legacy, sizeof(legacy));
+    log = boot(scheduler, sram);
+    CHECK(!contains(log, "Migrating"));
+    CHECK(contains(log, "No valid schedule bank"));
+}
+
+static void tornBank() {
+    MCP7940Scheduler scheduler;
+    uint8_t sram[64] = {};
+    boot(scheduler, sram);
+    CHECK(scheduler.setSchedule(0, {5, 0, 60, DOW_EVERYDAY, true}));
+    CHECK(scheduler.setSchedule(1, {5, 10, 60, DOW_EVERYDAY, true}));
+
+    // Damage the bank written last, the one before it still holds the first edit
+    uint8_t newer = fakeRtc.reg[FakeMCP7940::SRAM + 2] > fakeRtc.reg[FakeMCP7940::SRAM + 32 + 2] ? 0 : 32;
+    fakeRtc.reg[FakeMCP7940::SRAM + newer + 9] ^= 0x40;
+    MCP7940Scheduler restarted;
+    Serial.muted = true;
+    restarted.begin();
+    Serial.muted = false;
+    CHECK_EQ(enabledSchedules(restarted), 1);
+}
+
+int main() {
+    blank();
+    legacyImage();
+    tornBank();
+    return checkResult("schedule_layout");
+}
@@ -0,0 +1,122 @@
+// The software clock between RTC reads: millis() carries it, a resync moves it to the RTC, and a
+// failed or garbled RTC read neither moves it nor lets alarms be programmed from garbage, and an
+// alarm flag resyncs it once when it is raised, not on every poll that still finds it set.
+#include "check.h"
+#include "MCP7940_Scheduler.h"
+#include <EEPROM.h>
+
+static void startClock(MCP7940Scheduler& scheduler) {
+    fakeRtc.reset();
+    EEPROM.reset();
+    scheduler.begin();
+    scheduler.setClockResyncInterval(60000);
+    fakeRtc.setTime(2025, 7, 2, 21, 14, 3, 3);
+}
+
+static void carriedByMillis() {
+    MCP7940Scheduler scheduler;
+    startClock(scheduler);
+    uint32_t started = scheduler.now().unixtime();
+    uint32_t bus = Wire.transactions;
+    delay(30000);
+    CHECK_EQ(scheduler.now().unixtime() - started, 30);
+    CHECK_EQ(Wire.transactions, bus);  // No RTC read inside the resync interval
+
+    // Resync behind what was handed out: time holds rather than going back, then follows the RTC
+    fakeRtc.tick(28);
+    delay(30000);
+    CHECK_EQ(scheduler.now().unixtime() - started, 30);
+    fakeRtc.tick(5);
+    delay(5000);
+    CHECK_EQ(scheduler.now().unixtime() - started, 33);
+}
+
+static void failedRead() {
+    MCP7940Scheduler scheduler;
+    startClock(scheduler);
+    uint32_t started = scheduler.now().unixtime();
+
+    // The resync read fails: the old anchor keeps counting
+    delay(90000);
+    fakeRtc.tick(90);
+    Wire.failTransfer(0);
+    CHECK_EQ(scheduler.now().unixtime() - started, 90);
+
+    // Garbled registers are refused the same way
+    uint8_t month = fakeRtc.reg[FakeMCP7940::RTCMTH];
+    fakeRtc.reg[FakeMCP7940::RTCMTH] = 0x13;
+    delay(1000);
+    CHECK_EQ(scheduler.now().unixtime() - started, 91);
+    fakeRtc.reg[FakeMCP7940::RTCMTH] = month;
+
+    // The next good read re-anchors on the RTC
+    fakeRtc.tick(2);
+    delay(1000);
+    CHECK_EQ(scheduler.now().unixtime() - started, 92);
+    DateTime time = scheduler.now();
+    CHECK_EQ(time.hour(), 21);
+    CHECK_EQ(time.minute(), 15);
+    CHECK_EQ(time.second(), 35);
+}
+
+static void noAlarmsFromGarbage() {
+    MCP7940Scheduler scheduler;
+    startClock(scheduler);
+    WateringSchedules schedules{};
+    schedules.items[0] = {21, 30, 60, DOW_EVERYDAY, true};
+    scheduler.setSchedules(schedules);
+
+    // Before any good read there is no time to program alarms from
+    uint8_t alarms[14];
+    memcpy(alarms, fakeRtc.reg + FakeMCP7940::ALM0SEC, sizeof(alarms));
+    Wire.failTransfer(0);
+    CHECK(!scheduler.setNextAlarm());
+    CHECK(memcmp(alarms, fakeRtc.reg + FakeMCP7940::ALM0SEC, sizeof(alarms)) == 0);
+    Wire.failTransfer(0);
+    CHECK(!scheduler.setManualStopTime(60));
+    CHECK(memcmp(alarms, fakeRtc.reg + FakeMCP7940::ALM0SEC, sizeof(alarms)) == 0);
+
+    CHECK(scheduler.setNextAlarm());
+    DateTime on, off;
+    scheduler.getAlarms(on, off);
+    CHECK_EQ(on.hour(), 21);
+    CHECK_EQ(on.minute(), 30);
+}
+
+// A fired alarm resyncs the clock once. Polled, its flag stays set for many calls and each of
+// them costs the status read alone.
+static void resyncOnNewAlarm() {
+    MCP7940Scheduler scheduler;
+    startClock(scheduler);
+    uint32_t bus = Wire.transactions;
+    scheduler.getAlarmStatus();
+    uint32_t statusRead = Wire.transactions - bus;
+
+    fakeRtc.reg[FakeMCP7940::CONTROL] |= 0x10;  // ALM0EN
+    fakeRtc.reg[FakeMCP7940::ALM0WKDAY] |= 0x08;
+    bus = Wire.transactions;
+    CHECK(scheduler.getAlarmStatus().triggered[ALARM::ONTRIGGER]);
+    CHECK(Wire.transactions - bus > statusRead);
+    for (int second = 0; second < 10; ++second) {
+        delay(1000);
+        bus = Wire.transactions;
+        CHECK(scheduler.getAlarmStatus().triggered[ALARM::ONTRIGGER]);
+        CHECK_EQ(Wire.transactions - bus, statusRead);
+    }
+
+    // The other alarm firing on top is new again
+    fakeRtc.reg[FakeMCP7940::CONTROL] |= 0x20;  // ALM1EN
+    fakeRtc.reg[FakeMCP7940::ALM1WKDAY] |= 0x08;
+    bus = Wire.transactions;
+    CHECK(scheduler.getAlarmStatus().triggered[ALARM::OFFTRIGGER]);
+    CHECK(Wire.transactions - bus > statusRead);
+}
+
+int main() {
+    Serial.muted = true;
+    carriedByMillis();
+    failedRead();
+    noAlarmsFromGarbage();
+    resyncOnNewAlarm();
+    return checkResult("software_clock");
+}
@@ -0,0 +1,115 @@
+// Next alarm lookup on the compiled weekly timeline: overlapping and touching runs are served as
+// one run, including across Saturday midnight, and a full table of 32 daily schedules fits. Ends
+// with the cost of setNextAlarm() on the full table.
+#include "check.h"
+#include "MCP7940_Scheduler.h"
+#include <EEPROM.h>
+
+struct Alarms {
+    DateTime on;
+    DateTime off;
+};
+
+// Program the schedules, set the clock and return the alarms setNextAlarm() picked.
+// 2025-07-05 is a Saturday, 07-06 a Sunday and 07-07 a Monday.
+static Alarms nextAlarms(MCP7940Scheduler& scheduler, const WateringSchedules& schedules, uint8_t day,
+                         uint8_t hour, uint8_t minute) {
+    fakeRtc.reset();
+    EEPROM.reset();
+    scheduler.begin();
+    scheduler.setSchedules(schedules);
+    fakeRtc.setTime(2025, 7, day, hour, minute, 0, day == 6 ? 7 : day - 6);
+    Alarms alarms;
+    scheduler.setNextAlarm();
+    scheduler.getAlarms(alarms.on, alarms.off);
+    return alarms;
+}
+
+#define CHECK_TIME(time, expectedDay, expectedHour, expectedMinute) \
+    do {                                                            \
+        CHECK_EQ((time).day(), expectedDay);                        \
+        CHECK_EQ((time).hour(), expectedHour);                      \
+        CHECK_EQ((time).minute(), expectedMinute);                  \
+        CHECK_EQ((time).second(), 0);                               \
+    } while (0)
+
+static void mergedRuns() {
+    MCP7940Scheduler scheduler;
+    WateringSchedules schedules{};
+
+    // Overlapping: 06:00 for an hour and 06:30 for an hour run 06:00-07:30
+    schedules.items[3] = {6, 30, 3600, DOW_MONDAY, true};
+    schedules.items[9] = {6, 0, 3600, DOW_MONDAY, true};
+    Alarms alarms = nextAlarms(scheduler, schedules, 7, 5, 0);
+    CHECK_TIME(alarms.on, 7, 6, 0);
+    CHECK_TIME(alarms.off, 7, 7, 30);
+
+    // Touching runs chain: 06:00, 06:01 and 06:02 for a minute each
+    schedules = {};
+    schedules.items[0] = {6, 0, 60, DOW_MONDAY, true};
+    schedules.items[1] = {6, 1, 60, DOW_MONDAY, true};
+    schedules.items[2] = {6, 2, 60, DOW_MONDAY, true};
+    alarms = nextAlarms(scheduler, schedules, 7, 5, 0);
+    CHECK_TIME(alarms.on, 7, 6, 0);
+    CHECK_TIME(alarms.off, 7, 6, 3);
+
+    // A run inside another never starts the pump: from 06:05 the next run is tomorrow's 06:00
+    schedules = {};
+    schedules.items[0] = {6, 0, 3600, DOW_EVERYDAY, true};
+    schedules.items[1] = {6, 10, 60, DOW_EVERYDAY, true};
+    alarms = nextAlarms(scheduler, schedules, 7, 5, 0);
+    CHECK_TIME(alarms.off, 7, 7, 0);
+    alarms = nextAlarms(scheduler, schedules, 7, 6, 5);
+    CHECK_TIME(alarms.on, 8, 6, 0);
+    CHECK_TIME(alarms.off, 8, 7, 0);
+}
+
+static void weekWrap() {
+    MCP7940Scheduler scheduler;
+    WateringSchedules schedules{};
+    // Saturday 23:30 for 60 minutes swallows Sunday 00:10 and 00:20, which carries it to 00:40
+    schedules.items[0] = {23, 30, 3600, DOW_SATURDAY, true};
+    schedules.items[1] = {0, 10, 600, DOW_SUNDAY, true};
+    schedules.items[2] = {0, 20, 1200, DOW_SUNDAY, true};
+    schedules.items[3] = {1, 0, 60, DOW_SUNDAY, true};
+    Alarms alarms = nextAlarms(scheduler, schedules, 5, 20, 0);
+    CHECK_TIME(alarms.on, 5, 23, 30);
+    CHECK_TIME(alarms.off, 6, 0, 40);
+
+    // The swallowed Sunday runs are skipped, 01:00 is the next one
+    alarms = nextAlarms(scheduler, schedules, 6, 0, 5);
+    CHECK_TIME(alarms.on, 6, 1, 0);
+    CHECK_TIME(alarms.off, 6, 1, 1);
+
+    // After the last run of the week the lookup wraps to Saturday again
+    alarms = nextAlarms(scheduler, schedules, 6, 2, 0);
+    CHECK_TIME(alarms.on, 12, 23, 30);
+    CHECK_TIME(alarms.off, 13, 0, 40);
+}
+
+static void fullTable() {
+    static_assert(sizeof(TimelineEntry) == 4, "timeline entries are packed");
+    MCP7940Scheduler scheduler;
+    WateringSchedules schedules{};
+    for (uint8_t i = 0; i < MAX_SCHEDULES; ++i) {
+        schedules.items[i] = {(uint8_t)(i % 24), (uint8_t)(i * 7 % 60), 90, DOW_EVERYDAY, true};
+    }
+    // Slot 31 runs last in the day, 07:37 for 90 s
+    Alarms alarms = nextAlarms(scheduler, schedules, 7, 7, 36);
+    CHECK_TIME(alarms.on, 7, 7, 37);
+    CHECK_EQ(alarms.off.unixtime() - alarms.on.unixtime(), 90);
+    alarms = nextAlarms(scheduler, schedules, 7, 23, 59);
+    CHECK_TIME(alarms.on, 8, 0, 0);
+
+    double lookup = nanosPerCall(20000, [&](unsigned long) { scheduler.setNextAlarm(); });
+    printf("setNextAlarm() on %u runs: %.0f ns, timeline %u bytes\n", MAX_SCHEDULES * 7, lookup,
+           (unsigned)(sizeof(TimelineEntry) * MAX_SCHEDULES * 7));
+}
+
+int main() {
+    Serial.muted = true;
+    mergedRuns();
+    weekWrap();
+    fullTable();
+    return checkResult("timeline");
+}
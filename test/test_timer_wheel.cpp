@@ -0,0 +1,153 @@
+// TimerWheel driven by the simulated Ticker: period accuracy at every wheel level including the
+// parked timers past level 1, coalescing of aligned periods, one-shots, starting and stopping
+// from callbacks, and the Ticker going quiet when no timer runs. Prints the cost per tick of the
+// sketch's timer set.
+#include "check.h"
+#include "Timer.h"
+
+struct Fired {
+    uint32_t count;
+    uint32_t first;
+    uint32_t last;
+    bool even;  // Every gap equal to the period
+};
+
+static Fired fired[8];
+static uint32_t periods[8];
+
+static void record(int id) {
+    Fired& f = fired[id];
+    uint32_t now = millis();
+    if (f.count > 0 && now - f.last != periods[id]) f.even = false;
+    if (f.count == 0) f.first = now;
+    f.last = now;
+    f.count++;
+}
+
+static void resetFired() {
+    for (Fired& f : fired) f = {0, 0, 0, true};
+}
+
+// The periods the sketch runs while the pump is on
+static Timer sampler(50, Timer::SCHEDULER, [] { record(0); });
+static Timer led(500, Timer::SCHEDULER, [] { record(1); });
+static Timer alarms(1000, Timer::SCHEDULER, [] { record(2); });
+static Timer mqtt(5000, Timer::SCHEDULER, [] { record(3); });
+static Timer heartbeat(30000, Timer::SCHEDULER, [] { record(4); });
+static Timer publish(30000, Timer::SCHEDULER, [] { record(5); });
+static Timer scrub(3600000, Timer::SCHEDULER, [] { record(6); });
+static Timer* const sketchTimers[] = {&sampler, &led, &alarms, &mqtt, &heartbeat, &publish, &scrub};
+
+static void periodic() {
+    resetFired();
+    for (int i = 0; i < 7; ++i) {
+        periods[i] = sketchTimers[i]->getInterval();
+        sketchTimers[i]->start();
+    }
+    TimerWheel::instance().resetStats();
+    const uint32_t hours = 3;
+    Ticker::runTickers(hours * 3600000UL);
+
+    for (int i = 0; i < 7; ++i) {
+        CHECK_EQ(fired[i].count, hours * 3600000UL / periods[i]);
+        CHECK(fired[i].even);
+    }
+    // The hourly scrub sits past level 1 (72000 ticks) and still fires on the hour
+    CHECK_EQ(fired[6].last - fired[6].first, (hours - 1) * 3600000UL);
+    // Aligned periods land on the same tick: all seven together once an hour
+    CHECK_EQ(fired[4].first, fired[5].first);
+    CHECK_EQ(TimerWheel::instance().getMaxJobsPerTick(), 7);
+    CHECK_EQ(TimerWheel::instance().getMaxJitterMs(), 0);
+    CHECK_EQ(TimerWheel::instance().getTicks(), hours * 3600000UL / TIMER_TICK_MS);
+
+    for (Timer* timer : sketchTimers) timer->stop();
+}
+
+static void intervalsRoundUp() {
+    resetFired();
+    Timer odd(120, Timer::SCHEDULER, [] { record(0); });
+    periods[0] = 150;  // Three whole ticks
+    odd.start();
+    Ticker::runTickers(1500);
+    CHECK_EQ(fired[0].count, 10);
+    CHECK(fired[0].even);
+    odd.stop();
+}
+
+static Timer oneShot(200, Timer::ONESHOT, [] { record(0); });
+static Timer rearming(100, Timer::ONESHOT, [] {
+    record(1);
+    if (fired[1].count < 3) rearming.start();  // Restart from its own callback
+});
+
+static void oneShots() {
+    resetFired();
+    oneShot.start();
+    Ticker::runTickers(1000);
+    CHECK_EQ(fired[0].count, 1);
+    CHECK(!oneShot.isRunning());
+
+    rearming.start();
+    Ticker::runTickers(1000);
+    CHECK_EQ(fired[1].count, 3);
+    CHECK(!rearming.isRunning());
+}
+
+// Two timers due on the same tick, the first stops the second before it runs
+static Timer victim(1000, Timer::SCHEDULER, [] { record(1); });
+static Timer stopper(1000, Timer::SCHEDULER, [] {
+    record(0);
+    victim.stop();
+});
+
+static void stopFromCallback() {
+    resetFired();
+    // Filing pushes to the front of the slot, so the timer started last runs first
+    victim.start();
+    stopper.start();
+    Ticker::runTickers(3000);
+    CHECK_EQ(fired[0].count, 3);
+    CHECK_EQ(fired[1].count, 0);
+    CHECK(!victim.isRunning());
+    stopper.stop();
+}
+
+static void idle() {
+    resetFired();
+    TimerWheel::instance().resetStats();
+    Ticker::runTickers(10000);
+    CHECK_EQ(TimerWheel::instance().getTicks(), 0);
+
+    // A restart is due a full period after it, not at the old expiry
+    Timer later(1000, Timer::ONESHOT, [] { record(0); });
+    later.start();
+    Ticker::runTickers(900);
+    later.restart();
+    Ticker::runTickers(900);
+    CHECK_EQ(fired[0].count, 0);
+    Ticker::runTickers(100);
+    CHECK_EQ(fired[0].count, 1);
+    Ticker::runTickers(1000);
+    // The wheel stops ticking once the one-shot has fired at 1.9 s
+    CHECK_EQ(TimerWheel::instance().getTicks(), 38);
+}
+
+static void overhead() {
+    const unsigned long ticks = 200000;
+    double quiet = nanosPerCall(ticks, [](unsigned long) { Ticker::runTickers(TIMER_TICK_MS); });
+    for (Timer* timer : sketchTimers) timer->start();
+    double loaded = nanosPerCall(ticks, [](unsigned long) { Ticker::runTickers(TIMER_TICK_MS); });
+    for (Timer* timer : sketchTimers) timer->stop();
+    printf("ns per 50 ms tick: no timers %.1f, sketch timers %.1f, wheel work %.1f\n", quiet, loaded,
+           loaded - quiet);
+}
+
+int main() {
+    periodic();
+    intervalsRoundUp();
+    oneShots();
+    stopFromCallback();
+    idle();
+    overhead();
+    return checkResult("timer_wheel");
+}
@@ -0,0 +1,87 @@
+// TlsSessionCache with the simulated BearSSL client and RTC user memory: a full handshake is
+// saved, a resumed one writes nothing, both sessions survive a restart, and a damaged or missing
+// record restores nothing. The loader's first 128 bytes of RTC memory are never touched.
+#include "check.h"
+#include "TlsSessionCache.h"
+
+static bool isEmpty(const BearSSL::Session& session) {
+    for (uint8_t byte : session.parameters) {
+        if (byte) return false;
+    }
+    return true;
+}
+
+static void fullThenResumed() {
+    memset(ESP.rtcMemory, 0x5A, TLS_SESSION_RTC_BLOCK * 4);  // The OTA loader's area
+    TlsSessionCache cache;
+    CHECK(!cache.restore());
+    CHECK(isEmpty(cache.mqtt));
+
+    BearSSL::WiFiClientSecure client;
+    client.setSession(&cache.mqtt);
+    client.setTimeout(5000);
+    CHECK(client.connect("broker", 8883));
+    CHECK_EQ(client.fullHandshakes, 1);
+    uint32_t writes = ESP.rtcWrites;
+    CHECK(!cache.noteHandshake(cache.mqtt));
+    CHECK_EQ(ESP.rtcWrites, writes + 1);
+
+    // Reconnecting with the same session resumes it and leaves RTC memory alone
+    client.stop();
+    CHECK(client.connect("broker", 8883));
+    CHECK(client.resumed);
+    CHECK(cache.noteHandshake(cache.mqtt));
+    CHECK_EQ(ESP.rtcWrites, writes + 1);
+
+    // The update host has its own session on the same client
+    client.stop();
+    client.setSession(&cache.ota);
+    CHECK(client.connect("update", 443));
+    CHECK(!cache.noteHandshake(cache.ota));
+    CHECK_EQ(ESP.rtcWrites, writes + 2);
+
+    // The server forgot the broker session: a full handshake replaces it
+    client.stop();
+    client.setSession(&cache.mqtt);
+    client.serverKnowsSession = false;
+    CHECK(client.connect("broker", 8883));
+    CHECK(!client.resumed);
+    CHECK(!cache.noteHandshake(cache.mqtt));
+    CHECK_EQ(ESP.rtcWrites, writes + 3);
+
+    for (size_t i = 0; i < TLS_SESSION_RTC_BLOCK * 4; ++i) CHECK_EQ(ESP.rtcMemory[i], 0x5A);
+}
+
+static void restart() {
+    // Sessions from fullThenResumed() are in RTC memory, a new cache is a restarted device
+    TlsSessionCache saved;
+    CHECK(saved.restore());
+    BearSSL::WiFiClientSecure client;
+    client.setTimeout(5000);
+    client.setSession(&saved.mqtt);
+    CHECK(client.connect("broker", 8883));
+    CHECK(client.resumed);
+    CHECK(saved.noteHandshake(saved.mqtt));
+    client.stop();
+    client.setSession(&saved.ota);
+    CHECK(client.connect("update", 443));
+    CHECK(client.resumed);
+
+    // One flipped bit fails the CRC, nothing is restored
+    ESP.rtcMemory[TLS_SESSION_RTC_BLOCK * 4 + 20] ^= 0x01;
+    TlsSessionCache damaged;
+    CHECK(!damaged.restore());
+    CHECK(isEmpty(damaged.mqtt));
+    CHECK(isEmpty(damaged.ota));
+
+    // Nor after a power cycle
+    memset(ESP.rtcMemory, 0, sizeof(ESP.rtcMemory));
+    TlsSessionCache cold;
+    CHECK(!cold.restore());
+}
+
+int main() {
+    fullThenResumed();
+    restart();
+    return checkResult("tls_session_cache");
+}
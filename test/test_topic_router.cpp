@@ -0,0 +1,127 @@
+// The MQTT topic route table and the colon separated payload parsers: accepted and rejected
+// payloads, which handler a topic reaches, and the dispatch cost against the strcmp chain it
+// replaced.
+#include "check.h"
+#include "TopicRouter.h"
+#include "objects.h"
+
+static int called[5];
+static size_t lastLength;
+
+template <int Route>
+static void handler(const char*, size_t length) {
+    called[Route]++;
+    lastLength = length;
+}
+
+static constexpr TopicRoute routes[] = {
+    TOPIC_ROUTE(PUMP_CONTROL_TOPIC, handler<0>),
+    TOPIC_ROUTE(SET_SCHEDULE, handler<1>),
+    TOPIC_ROUTE(REQUEST_ALL_SCHEDULES, handler<2>),
+    TOPIC_ROUTE(GET_UPDATE_REQUEST, handler<3>),
+    TOPIC_ROUTE(RESTART, handler<4>),
+};
+
+// The dispatch before the route table
+static bool strcmpChain(const char* topic, const char* payload, size_t length) {
+    if (strcmp(topic, PUMP_CONTROL_TOPIC) == 0) handler<0>(payload, length);
+    else if (strcmp(topic, SET_SCHEDULE) == 0) handler<1>(payload, length);
+    else if (strcmp(topic, REQUEST_ALL_SCHEDULES) == 0) handler<2>(payload, length);
+    else if (strcmp(topic, GET_UPDATE_REQUEST) == 0) handler<3>(payload, length);
+    else if (strcmp(topic, RESTART) == 0) handler<4>(payload, length);
+    else return false;
+    return true;
+}
+
+static void routing() {
+    const char* topics[] = {PUMP_CONTROL_TOPIC, SET_SCHEDULE, REQUEST_ALL_SCHEDULES, GET_UPDATE_REQUEST, RESTART};
+    for (int i = 0; i < 5; ++i) {
+        memset(called, 0, sizeof(called));
+        CHECK(routeTopic(routes, topics[i], "12", 2));
+        for (int j = 0; j < 5; ++j) CHECK_EQ(called[j], i == j);
+        CHECK_EQ(lastLength, 2);
+    }
+    // A prefix, an extension or an unknown topic of the same length reaches nothing
+    memset(called, 0, sizeof(called));
+    CHECK(!routeTopic(routes, "beegreen/set_schedul", "", 0));
+    CHECK(!routeTopic(routes, "beegreen/set_schedules", "", 0));
+    CHECK(!routeTopic(routes, "beegreen/get_schedulez", "", 0));
+    CHECK(!routeTopic(routes, "", "", 0));
+    for (int j = 0; j < 5; ++j) CHECK_EQ(called[j], 0);
+}
+
+static bool parses(const char* payload, int& index, ScheduleItem& item) {
+    return parseSchedulePayload(payload, strlen(payload), index, item);
+}
+
+static void schedulePayloads() {
+    int index;
+    ScheduleItem item;
+    CHECK(parses("1:20:30:90:127:1", index, item));
+    CHECK_EQ(index, 1);
+    CHECK_EQ(item.hour, 20);
+    CHECK_EQ(item.minute, 30);
+    CHECK_EQ(item.duration_sec, 90);
+    CHECK_EQ(item.daysOfWeek, 127);
+    CHECK(item.enabled);
+    CHECK(parses("31:0:0:65535:0:0", index, item));
+    CHECK_EQ(index, 31);
+    CHECK_EQ(item.duration_sec, 65535);
+    CHECK(!item.enabled);
+
+    const char* rejected[] = {
+        "",                   // Empty
+        "1:20:30:90:127",     // Field missing
+        "1:20:30:90:127:1:",  // Trailing separator
+        "1:20:30:90:127:1x",  // Trailing text
+        "32:20:30:90:127:1",  // Index past the last slot
+        "1:24:30:90:127:1",   // Hour
+        "1:20:60:90:127:1",   // Minute
+        "1:20:30:65536:127:1",  // Duration past 16 bits
+        "1:20:30:90:128:1",   // Days past the weekday mask
+        "1:20:30:90:127:2",   // Enabled is 0 or 1
+        "-1:20:30:90:127:1",  // Sign
+        "1::30:90:127:1",     // Empty field
+        "1:20:30:99999999999999999999:127:1",  // Overflows before the range check could
+    };
+    for (const char* payload : rejected) {
+        if (parses(payload, index, item)) {
+            fprintf(stderr, "accepted \"%s\"\n", payload);
+            checkFailures()++;
+        }
+    }
+
+    // The view is bounded: digits after length are not read
+    const char bounded[] = "1:20:30:90:127:19";
+    CHECK(parseSchedulePayload(bounded, sizeof(bounded) - 2, index, item));
+    CHECK(item.enabled);
+
+    // Pump durations use a single field
+    size_t pos = 0;
+    uint32_t duration;
+    CHECK(parseField("300", 3, pos, UINT16_MAX, true, duration));
+    CHECK_EQ(duration, 300);
+    pos = 0;
+    CHECK(!parseField("300s", 4, pos, UINT16_MAX, true, duration));
+    pos = 0;
+    CHECK(!parseField("70000", 5, pos, UINT16_MAX, true, duration));
+}
+
+static void benchmark() {
+    const char* topics[] = {PUMP_CONTROL_TOPIC, SET_SCHEDULE, REQUEST_ALL_SCHEDULES, GET_UPDATE_REQUEST,
+                            RESTART, "beegreen/unknown_topic"};
+    // Copies, so the compiler cannot fold the comparisons against the literals
+    static char received[6][48];
+    for (int i = 0; i < 6; ++i) strcpy(received[i], topics[i]);
+    const unsigned long iterations = 3000000;
+    double table = nanosPerCall(iterations, [&](unsigned long i) { routeTopic(routes, received[i % 6], "1", 1); });
+    double chain = nanosPerCall(iterations, [&](unsigned long i) { strcmpChain(received[i % 6], "1", 1); });
+    printf("Topic dispatch ns per message: route table %.1f, strcmp chain %.1f\n", table, chain);
+}
+
+int main() {
+    routing();
+    schedulePayloads();
+    benchmark();
+    return checkResult("topic_router");
+}